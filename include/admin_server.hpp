@@ -0,0 +1,97 @@
+#ifndef ADMIN_SERVER_H
+#define ADMIN_SERVER_H
+
+#include "event_loop.hpp"
+#include "fleet_scheduler.hpp"
+#include "modbus_server.hpp"
+#include "simulation_engine.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class AdminServer
+ * @brief Line-based admin interface on a Unix socket for changing a running simulator.
+ *
+ * Each request is one line of space-separated words; the reply is zero or
+ * more data lines followed by a status line, "OK" or "ERR <reason>", so a
+ * script can pipeline requests and read replies up to each status line.
+ * Requests on one connection are answered in order.
+ *
+ * The socket is served on an existing EventLoop (the main thread's). Commands
+ * that touch a device are posted to that device's SimulationEngine command
+ * queue and run between ticks by the FleetScheduler; Modbus counters are read on the
+ * Modbus loop threads and summed. Results are posted back to this loop, so nothing here
+ * takes a lock on a hot path. Send "help" for the command list.
+ */
+class AdminServer {
+public:
+    /**
+     * @param loop The loop serving the socket; must outlive the server.
+     * @param engines The simulation engines, indexed like config.devices.
+     * @param scheduler The scheduler ticking them, for "metrics".
+     * @param modbus_servers The Modbus/TCP servers (one per NUMA shard) for "metrics"; may be empty.
+     */
+    AdminServer(EventLoop& loop, std::vector<SimulationEngine*> engines, const FleetScheduler* scheduler,
+                std::vector<ModbusServer*> modbus_servers);
+
+    /**
+     * @brief Destructor, closes the socket and every client.
+     */
+    ~AdminServer();
+
+    /**
+     * @brief Listens on a Unix stream socket, replacing a stale socket file.
+     * @return True on success, false on failure.
+     * @note Call from the loop thread or before the loop runs.
+     */
+    bool start(const std::string& socket_path);
+
+    /**
+     * @brief Closes the socket and every client, and removes the socket file.
+     * @note Call from the loop thread or after the loop has stopped.
+     */
+    void stop();
+
+private:
+    /// Receives the reply text, data lines and status line included; may be called from any thread.
+    using ReplyHandler = std::function<void(std::string reply)>;
+    /// Runs on the device's shard scheduler thread between rounds; appends data lines to output, false on failure.
+    using EngineCommand = std::function<bool(size_t index, SimulationEngine& engine, std::string& output)>;
+
+    struct Client {
+        int fd;
+        uint32_t id;
+        bool busy = false;  // A request is being executed; later lines wait in rx
+        std::string rx;     // Bytes of lines not executed yet
+        std::string tx;     // Reply bytes the socket did not accept yet
+        uint32_t events = 0; // Current epoll interest
+    };
+
+    void onAccept();
+    void onClientEvent(Client& client, uint32_t events);
+    void processNext(Client& client);
+    void complete(int fd, uint32_t id, std::string reply);
+    bool flush(Client& client);
+    void updateInterest(Client& client);
+    void closeClient(Client& client);
+
+    void execute(const std::vector<std::string>& args, ReplyHandler done);
+    bool selectEngines(const std::string& selector, std::vector<size_t>& indices, std::string& error) const;
+    void runOnEngines(std::vector<size_t> indices, EngineCommand command, ReplyHandler done);
+    void replyMetrics(ReplyHandler done);
+
+    EventLoop& loop;
+    std::vector<SimulationEngine*> engines;
+    const FleetScheduler* scheduler;
+    std::vector<ModbusServer*> modbus_servers;
+    std::string socket_path;
+    int listen_fd;
+    uint32_t client_count;
+    std::unordered_map<int, std::unique_ptr<Client>> clients; // Indexed by socket
+};
+
+#endif // ADMIN_SERVER_H
@@ -0,0 +1,58 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @class BufferPool
+ * @brief Slab allocator of fixed-size byte blocks.
+ *
+ * Blocks are carved from slabs of blocks_per_slab blocks and recycled through
+ * a free list, so acquiring and releasing a block is O(1) and never touches
+ * the heap once the pool has grown to its peak. Slabs are kept until the pool
+ * is destroyed. Not thread-safe: use it from one thread.
+ */
+class BufferPool {
+public:
+    /**
+     * @param block_size Size of every block in bytes.
+     * @param blocks_per_slab Blocks allocated at once when the free list runs dry.
+     */
+    BufferPool(size_t block_size, size_t blocks_per_slab);
+
+    /**
+     * @brief Takes a block of blockSize() bytes from the pool.
+     */
+    uint8_t* acquire();
+
+    /**
+     * @brief Returns a block obtained from acquire().
+     */
+    void release(uint8_t* block);
+
+    size_t blockSize() const {
+        return block_size;
+    }
+
+    /// Blocks currently handed out.
+    size_t inUse() const {
+        return in_use;
+    }
+
+    /// Blocks allocated so far, handed out or free.
+    size_t capacity() const {
+        return slabs.size() * blocks_per_slab;
+    }
+
+private:
+    size_t block_size;
+    size_t blocks_per_slab;
+    size_t in_use;
+    std::vector<std::unique_ptr<uint8_t[]>> slabs;
+    std::vector<uint8_t*> free_blocks;
+};
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,118 @@
+#ifndef CHANGE_FEED_H
+#define CHANGE_FEED_H
+
+#include "safe_data_model.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct ChangeFeedFrameHeader
+ * @brief Header of a delta frame streamed over the change-feed socket.
+ *
+ * Each frame is followed by `count` RegisterDelta records (address, value).
+ * All fields are in host byte order, since the socket is local. A client
+ * starts a subscription by sending the last generation it has seen as a
+ * single 64-bit integer (0 for a full image); the server answers with one
+ * catch-up frame and then one frame per tick that changed any register.
+ */
+struct ChangeFeedFrameHeader {
+    static constexpr uint32_t MAGIC = 0x44414D53; // "SMAD"
+
+    uint32_t magic;
+    uint32_t count;
+    uint64_t generation;
+};
+
+/**
+ * @class ChangeFeed
+ * @brief Streams per-tick register changes to in-process and Unix-socket subscribers.
+ *
+ * onTick() is registered as a simulation engine tick listener. In-process
+ * subscribers are invoked synchronously on the simulation thread with the
+ * tick's dirty set; socket subscribers are served from a dedicated thread.
+ */
+class ChangeFeed {
+public:
+    using Subscriber = std::function<void(uint64_t generation, const std::vector<RegisterDelta>& changes)>;
+
+    /**
+     * @brief Constructor for the ChangeFeed.
+     * @param data_model A shared pointer to the thread-safe data model.
+     */
+    explicit ChangeFeed(std::shared_ptr<SafeDataModel> data_model);
+
+    /**
+     * @brief Destructor, ensures the socket thread is stopped.
+     */
+    ~ChangeFeed();
+
+    /**
+     * @brief Adds an in-process subscriber.
+     * @param subscriber Called on the simulation thread for every tick with changes.
+     * @return An id that can be passed to unsubscribe().
+     */
+    int subscribe(Subscriber subscriber);
+
+    /**
+     * @brief Removes an in-process subscriber.
+     */
+    void unsubscribe(int id);
+
+    /**
+     * @brief Starts serving subscriptions on a Unix domain socket.
+     * @param socket_path Filesystem path of the listening socket.
+     * @return True on success, false on failure.
+     */
+    bool start(const std::string& socket_path);
+
+    /**
+     * @brief Stops the socket thread and removes the socket file.
+     */
+    void stop();
+
+    /**
+     * @brief Publishes the changes of a committed tick.
+     * @param generation The generation returned by SafeDataModel::commitTick().
+     */
+    void onTick(uint64_t generation);
+
+private:
+    struct Client {
+        int fd;
+        bool subscribed;
+        uint64_t generation;
+        std::vector<uint8_t> inbox;
+        std::vector<uint8_t> outbox;
+    };
+
+    void run();
+    void acceptClients();
+    bool readSubscription(Client& client);
+    bool flushClient(Client& client);
+    void sendChanges(Client& client, uint64_t generation, const std::vector<RegisterDelta>& changes, bool always);
+
+    std::shared_ptr<SafeDataModel> data_model;
+
+    std::mutex subscriber_mutex;
+    std::vector<std::pair<int, Subscriber>> subscribers;
+    int next_subscriber_id;
+
+    // Most recent tick, handed from the simulation thread to the socket thread
+    std::mutex tick_mutex;
+    uint64_t published_generation;
+    std::vector<RegisterDelta> published_changes;
+
+    std::string socket_path;
+    int listen_fd;
+    int wake_pipe[2];
+    std::vector<Client> clients;
+    std::thread feed_thread;
+    std::atomic<bool> running;
+};
+
+#endif // CHANGE_FEED_H
@@ -0,0 +1,95 @@
+#ifndef COLUMNAR_EXPORTER_H
+#define COLUMNAR_EXPORTER_H
+
+#include "safe_data_model.hpp"
+#include "columnar_format.hpp"
+#include "spsc_queue.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class ColumnarExporter
+ * @brief Streams selected registers per tick into an append-only columnar file.
+ *
+ * onTick() runs on the simulation thread and only copies one row into a
+ * lock-free queue; encoding and disk I/O happen on a background writer
+ * thread. If the writer falls behind and the queue fills, rows are dropped
+ * and counted rather than blocking the tick. See columnar_format.hpp for
+ * the file layout and tools/columnar_reader.cpp for a reader.
+ */
+class ColumnarExporter {
+public:
+    /**
+     * @brief Constructor for the ColumnarExporter.
+     * @param data_model A shared pointer to the thread-safe data model.
+     * @param device The device configuration, used for identity and register types.
+     */
+    ColumnarExporter(std::shared_ptr<SafeDataModel> data_model, const DeviceConfig& device);
+
+    /**
+     * @brief Destructor, flushes and stops the writer thread.
+     */
+    ~ColumnarExporter();
+
+    /**
+     * @brief Opens the output file and starts the writer thread.
+     * @param filename Output file; new data is appended as a new file section if it exists.
+     * @param addresses Logical start addresses of the registers to record.
+     * @param rows_per_block Rows encoded per independently decodable block.
+     * @return True on success, false on failure.
+     */
+    bool start(const std::string& filename, const std::vector<uint16_t>& addresses, size_t rows_per_block);
+
+    /**
+     * @brief Flushes the partial block and stops the writer thread.
+     */
+    void stop();
+
+    /**
+     * @brief Queues one row for the tick that was just committed.
+     * @param generation The generation returned by SafeDataModel::commitTick().
+     */
+    void onTick(uint64_t generation);
+
+    /**
+     * @brief Number of rows dropped because the writer queue was full.
+     */
+    uint64_t droppedRows() const;
+
+private:
+    void run();
+    void appendRow(const std::vector<int64_t>& row);
+    void writeBlock();
+
+    std::shared_ptr<SafeDataModel> data_model;
+    DeviceIdentity identity;
+    int interval_ms;
+    std::shared_ptr<const std::vector<Register>> registers;
+
+    std::vector<uint16_t> addresses;
+    size_t rows_per_block;
+    std::ofstream out;
+
+    std::unique_ptr<SpscQueue<std::vector<int64_t>>> queue;
+    std::atomic<uint64_t> dropped_rows;
+
+    // Writer-thread state for the block being built
+    std::vector<columnar::ColumnEncoder> encoders;
+    uint32_t block_rows;
+    uint64_t block_first_generation;
+    int64_t block_first_timestamp_ms;
+    int64_t block_last_timestamp_ms;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    std::thread writer_thread;
+    std::atomic<bool> running;
+};
+
+#endif // COLUMNAR_EXPORTER_H
@@ -0,0 +1,153 @@
+#ifndef COLUMNAR_FORMAT_H
+#define COLUMNAR_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * On-disk layout of the columnar time-series files written by ColumnarExporter.
+ *
+ *   ColumnarFileHeader
+ *   ColumnarColumnInfo[column_count]
+ *   { ColumnarBlockHeader, uint32_t column_bytes[column_count], column data... }*
+ *
+ * Column 0 is the tick generation and column 1 the wall-clock timestamp in
+ * milliseconds; the remaining columns are the selected logical registers.
+ * Every column in a block is an independent stream of zigzag varints: plain
+ * deltas for registers, delta-of-delta for the generation and timestamp so a
+ * regular tick costs one byte. Encoding restarts in every block, so a reader
+ * can skip straight to any block using the headers alone. Fixed-size fields
+ * are stored in host byte order (little-endian on all supported targets).
+ */
+namespace columnar {
+
+    constexpr uint32_t FILE_MAGIC = 0x54414D53;  // "SMAT"
+    constexpr uint32_t BLOCK_MAGIC = 0x42414D53; // "SMAB"
+    constexpr uint32_t FORMAT_VERSION = 1;
+
+    enum class ColumnEncoding : uint8_t {
+        Delta = 0,
+        DeltaOfDelta = 1
+    };
+
+    struct ColumnarFileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t column_count;
+        uint32_t unit_id;
+        uint32_t serial_number;
+        uint32_t interval_ms;
+    };
+
+    struct ColumnarColumnInfo {
+        uint16_t address;  // Logical register address, 0 for the generation/timestamp columns
+        uint8_t type;      // RegisterType of the register
+        uint8_t encoding;  // ColumnEncoding
+    };
+
+    struct ColumnarBlockHeader {
+        uint32_t magic;
+        uint32_t row_count;
+        uint64_t first_generation;
+        int64_t first_timestamp_ms;
+        int64_t last_timestamp_ms;
+        uint64_t payload_bytes; // Bytes after this header, including the column length table
+    };
+
+    inline uint64_t zigzagEncode(int64_t value) {
+        return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+    }
+
+    inline int64_t zigzagDecode(uint64_t value) {
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    /**
+     * @brief Decodes one varint; returns false on truncated input.
+     */
+    inline bool getVarint(const uint8_t*& pos, const uint8_t* end, uint64_t& value) {
+        value = 0;
+        for (int shift = 0; pos < end && shift < 64; shift += 7) {
+            uint8_t byte = *pos++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @class ColumnEncoder
+     * @brief Incrementally encodes one column of a block.
+     */
+    class ColumnEncoder {
+    public:
+        explicit ColumnEncoder(ColumnEncoding enc = ColumnEncoding::Delta) : encoding(enc) {}
+
+        void append(int64_t value) {
+            int64_t delta = value - previous;
+            int64_t encoded = encoding == ColumnEncoding::DeltaOfDelta ? delta - previous_delta : delta;
+            putVarint(bytes, zigzagEncode(encoded));
+            previous = value;
+            previous_delta = delta;
+        }
+
+        void reset() {
+            bytes.clear();
+            previous = 0;
+            previous_delta = 0;
+        }
+
+        const std::vector<uint8_t>& data() const {
+            return bytes;
+        }
+
+    private:
+        ColumnEncoding encoding;
+        std::vector<uint8_t> bytes;
+        int64_t previous = 0;
+        int64_t previous_delta = 0;
+    };
+
+    /**
+     * @brief Decodes a whole column of a block into absolute values.
+     * @return False if the column is truncated or holds fewer than row_count values.
+     */
+    inline bool decodeColumn(
+        const uint8_t* pos,
+        const uint8_t* end,
+        ColumnEncoding encoding,
+        uint32_t row_count,
+        std::vector<int64_t>& values) {
+        values.resize(row_count);
+        int64_t previous = 0;
+        int64_t previous_delta = 0;
+        for (uint32_t i = 0; i < row_count; ++i) {
+            uint64_t raw;
+            if (!getVarint(pos, end, raw)) {
+                return false;
+            }
+            int64_t delta = zigzagDecode(raw);
+            if (encoding == ColumnEncoding::DeltaOfDelta) {
+                delta += previous_delta;
+            }
+            previous += delta;
+            previous_delta = delta;
+            values[i] = previous;
+        }
+        return true;
+    }
+
+} // namespace columnar
+
+#endif // COLUMNAR_FORMAT_H
@@ -3,13 +3,15 @@
 
 #include "digital_twin.hpp"
 #include <string>
+#include <vector>
 
 /**
  * @class ConfigLoader
  * @brief Parses the YAML configuration file to populate the Config structure.
  *
  * This class uses the yaml-cpp library to read the device profile and
- * simulation parameters from the specified file.
+ * simulation parameters from the specified file. Register schemas are parsed
+ * once per device template and shared by every device of a fleet.
  */
 class ConfigLoader {
 public:
@@ -20,6 +22,50 @@ public:
      * @throw std::runtime_error if the file cannot be opened or parsed.
      */
     static Config loadConfig(const std::string& filename);
+
+    /**
+     * @brief Rejects register lists whose definitions overlap or run past address 65535.
+     *
+     * Sorts the registers by address (O(n log n)) and checks each against its
+     * successor, so a U64 at 30513 and a register at 30515 are reported
+     * instead of silently sharing words.
+     * @param registers The registers of one template.
+     * @throw std::runtime_error describing the first conflict found.
+     */
+    static void validateRegisters(const std::vector<Register>& registers);
+
+    /**
+     * @brief Checks whether a freshly loaded configuration can replace the running one.
+     *
+     * The device list, identities and register layouts are baked into the data
+     * models and the Modbus/export front ends, so they must be unchanged;
+     * simulation parameters, weather models and per-device power and
+     * orientation may change freely.
+     * @param current The configuration currently in use.
+     * @param candidate The newly parsed configuration.
+     * @param reason Set to a human-readable explanation when incompatible.
+     * @return True if candidate may be swapped in at runtime.
+     */
+    static bool isReloadCompatible(const Config& current, const Config& candidate, std::string& reason);
+
+    /**
+     * @brief Derives a per-device file, socket or shared-memory name from a configured pattern.
+     *
+     * "{serial}" and "{unit_id}" are replaced by the device's values. If the
+     * pattern contains neither and unique is set (more than one device), the
+     * serial number is inserted before the extension instead.
+     */
+    static std::string expandDevicePath(const std::string& pattern, const DeviceIdentity& identity, bool unique);
+
+    /**
+     * @brief Derives the dedicated listener of a device in port-per-device mode.
+     *
+     * Device i listens on base port + i, or with per_address on base address + i
+     * (e.g. 127.0.1.1, 127.0.1.2, ...) at the base port. Unix socket paths are
+     * expanded with expandDevicePath().
+     */
+    static ModbusListenerParams deviceListener(const PortPerDeviceParams& params, size_t index,
+                                               const DeviceIdentity& identity);
 };
 
 #endif // CONFIG_LOADER_H
@@ -0,0 +1,69 @@
+#ifndef CONFIG_RELOADER_H
+#define CONFIG_RELOADER_H
+
+#include "digital_twin.hpp"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+/**
+ * @class ConfigReloader
+ * @brief Re-reads the YAML profile at runtime without restarting the simulator.
+ *
+ * A reload is triggered explicitly with requestReload() (e.g. on SIGHUP) or,
+ * optionally, whenever the file is rewritten (inotify on its directory, so
+ * editors that save by rename are covered). Parsing and the compatibility
+ * check run on the reloader's own thread; accepted configurations are handed
+ * to the callback as immutable shared pointers for atomic publication.
+ */
+class ConfigReloader {
+public:
+    using ReloadCallback = std::function<void(std::shared_ptr<const Config>)>;
+
+    /**
+     * @brief Constructor for the ConfigReloader.
+     * @param filename Path of the YAML profile.
+     * @param current The configuration currently in use.
+     * @param on_reload Called on the reloader thread with each accepted configuration.
+     */
+    ConfigReloader(const std::string& filename, std::shared_ptr<const Config> current, ReloadCallback on_reload);
+
+    /**
+     * @brief Destructor, ensures the reloader thread is stopped.
+     */
+    ~ConfigReloader();
+
+    /**
+     * @brief Starts the reloader thread.
+     * @param watch_file Also reload automatically when the file changes on disk.
+     * @return True on success, false on failure.
+     */
+    bool start(bool watch_file);
+
+    /**
+     * @brief Stops the reloader thread.
+     */
+    void stop();
+
+    /**
+     * @brief Asks the reloader thread to re-read the profile.
+     */
+    void requestReload();
+
+private:
+    void run();
+    void reload();
+
+    std::string filename;
+    std::shared_ptr<const Config> current;
+    ReloadCallback on_reload;
+
+    int wake_fd;
+    int inotify_fd;
+    std::thread reload_thread;
+    std::atomic<bool> running;
+};
+
+#endif // CONFIG_RELOADER_H
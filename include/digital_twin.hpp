@@ -2,20 +2,21 @@
 #define DIGITAL_TWIN_H
 
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include <variant>
 #include <unordered_map>
 
 /// @brief Defines the access type for a Modbus register.
-enum class RegisterAccess {
+enum class RegisterAccess : uint8_t {
     RO, ///< Read Only
     RW, ///< Read Write
     WO  ///< Write Only
 };
 
 /// @brief Defines the data format for a Modbus register.
-enum class RegisterFormat {
+enum class RegisterFormat : uint8_t {
     RAW,    ///< Raw value
     ENUM,   ///< Enumeration
     FIX0,   ///< Fixed point, 0 decimal places
@@ -30,7 +31,7 @@ enum class RegisterFormat {
 };
 
 /// @brief Defines the data type for a Modbus register.
-enum class RegisterType {
+enum class RegisterType : uint8_t {
     U16,
     S16,
     U32,
@@ -39,6 +40,42 @@ enum class RegisterType {
     S64
 };
 
+/// @brief Defines the distribution of simulated Modbus response latencies.
+enum class LatencyDistribution : uint8_t {
+    Fixed,    ///< Always latency_ms
+    Uniform,  ///< latency_ms +/- jitter_ms
+    Normal,   ///< Mean latency_ms, standard deviation jitter_ms
+    LogNormal ///< Mean latency_ms, standard deviation jitter_ms, with a long tail like real devices
+};
+
+/// @brief Defines the transport of a Modbus listener.
+enum class ModbusTransport : uint8_t {
+    TCP,  ///< Modbus TCP (MBAP over a TCP stream)
+    UDP,  ///< Modbus UDP (one MBAP frame per datagram)
+    UNIX  ///< MBAP over a Unix domain stream socket
+};
+
+/// @brief Defines how per-device memory arenas are backed.
+enum class HugePageMode : uint8_t {
+    Off,         ///< Normal pages
+    Transparent, ///< Normal mappings advised for transparent huge pages
+    Explicit     ///< Reserved huge pages (MAP_HUGETLB), falling back to normal pages
+};
+
+/// @brief Defines how the ticks of a fleet's devices are offset within their update interval.
+enum class TickPhase : uint8_t {
+    Aligned, ///< Every device ticks at the same moment
+    Even,    ///< Device k of n ticks k/n of an interval after the first
+    Random   ///< Each device ticks at a random offset within the interval
+};
+
+/// @brief Defines the kernel scheduling policy of the tick and server threads.
+enum class SchedulingPolicy : uint8_t {
+    Other,     ///< The default time-sharing policy
+    Fifo,      ///< SCHED_FIFO real-time priority
+    RoundRobin ///< SCHED_RR real-time priority
+};
+
 /**
  * @struct Register
  * @brief Holds all properties of a single Modbus register.
@@ -100,14 +137,208 @@ struct SimulationParams {
     std::vector<WeatherModel> weather_models;
 };
 
+/**
+ * @struct ResponseModelParams
+ * @brief How a device's Modbus TCP/UDP responses are delayed or lost, to exercise client timeouts.
+ */
+struct ResponseModelParams {
+    LatencyDistribution distribution = LatencyDistribution::Fixed;
+    double latency_ms = 0.0;
+    double jitter_ms = 0.0;
+    double min_latency_ms = 0.0;     // Samples are clamped to [min, max]
+    double max_latency_ms = 1000.0;
+    double loss_percent = 0.0;       // Requests that are silently dropped
+    double disconnect_percent = 0.0; // Requests that make the device close the connection instead of answering
+};
+
+/**
+ * @struct SharedMemoryParams
+ * @brief Controls publication of the register image into POSIX shared memory.
+ */
+struct SharedMemoryParams {
+    bool enabled = false;
+    std::string name = "/sma_twin";
+};
+
+/**
+ * @struct ChangeFeedParams
+ * @brief Controls the Unix-socket change-feed subscription service.
+ */
+struct ChangeFeedParams {
+    bool enabled = false;
+    std::string socket_path = "/tmp/sma_twin_feed.sock";
+};
+
+/**
+ * @struct AdminSocketParams
+ * @brief Controls the Unix-socket admin interface for runtime operations.
+ */
+struct AdminSocketParams {
+    bool enabled = false;
+    std::string socket_path = "/tmp/sma_twin_admin.sock";
+};
+
+/**
+ * @struct HistoryParams
+ * @brief Sizes the in-memory register history ring and its export target.
+ */
+struct HistoryParams {
+    bool enabled = false;
+    size_t max_frames = 3600;
+    size_t max_changes = 200000;
+    std::string export_path = "register_history.csv";
+};
+
+/**
+ * @struct ColumnarExportParams
+ * @brief Selects the registers streamed to the columnar time-series file.
+ */
+struct ColumnarExportParams {
+    bool enabled = false;
+    std::string path = "sma_twin_timeseries.bin";
+    size_t rows_per_block = 3600;
+    std::vector<uint16_t> registers;
+};
+
+/**
+ * @struct TrafficCaptureParams
+ * @brief Controls recording of Modbus frames into a memory-mapped ring file.
+ */
+struct TrafficCaptureParams {
+    bool enabled = false;
+    std::string path = "modbus_capture.bin";
+    size_t capacity_mb = 64;
+};
+
+/**
+ * @struct ModbusListenerParams
+ * @brief One socket the Modbus server listens on.
+ */
+struct ModbusListenerParams {
+    ModbusTransport transport = ModbusTransport::TCP;
+    std::string address = "127.0.0.1"; // TCP/UDP bind address
+    int port = 1502;                    // TCP/UDP port
+    std::string socket_path;            // Unix socket path
+};
+
+/**
+ * @struct PortPerDeviceParams
+ * @brief Gives every device its own listener, for clients that expect one endpoint per inverter.
+ */
+struct PortPerDeviceParams {
+    bool enabled = false;
+    ModbusListenerParams base;  // Endpoint of the first device; path may use {serial} / {unit_id}
+    bool per_address = false;   // Step the IPv4 address (loopback aliases) instead of the port
+};
+
+/**
+ * @struct RateLimitParams
+ * @brief Token buckets that shed excess Modbus requests with exception 06 (server busy).
+ */
+struct RateLimitParams {
+    bool enabled = false;
+    double connection_rate = 100.0;  // Requests per second per connection (0 = unlimited)
+    double connection_burst = 20.0;
+    double source_rate = 200.0;      // Requests per second per client address, across its connections (0 = unlimited)
+    double source_burst = 50.0;
+};
+
+/**
+ * @struct RtuBusParams
+ * @brief One virtual RS-485 bus served as Modbus RTU over a pseudo-terminal.
+ */
+struct RtuBusParams {
+    std::string link_path;      // Symlink created to the pty slave, e.g. /tmp/sma_rtu0
+    int baud_rate = 19200;
+    char parity = 'E';          // 'N', 'E' or 'O'
+    int stop_bits = 1;
+    std::vector<int> unit_ids;  // Devices on this bus; empty serves every device
+};
+
+/**
+ * @struct HotReloadParams
+ * @brief Controls runtime reloading of the profile (SIGHUP always triggers a reload).
+ */
+struct HotReloadParams {
+    bool watch_file = false;
+};
+
+/**
+ * @struct SchedulerParams
+ * @brief Controls the fleet scheduler that runs every device's ticks on a shared thread pool.
+ */
+struct SchedulerParams {
+    size_t threads = 0; // Pool size including the scheduler thread; 0 = one per core
+    bool numa_shards = false; // One shard of devices, threads and Modbus listeners per NUMA node
+    TickPhase phase = TickPhase::Aligned;
+};
+
+/**
+ * @struct MemoryArenaParams
+ * @brief Controls the arenas holding every device's registers and engine.
+ */
+struct MemoryArenaParams {
+    HugePageMode huge_pages = HugePageMode::Off;
+    size_t chunk_mb = 32; // Size of each mapping
+};
+
+/**
+ * @struct RealtimeParams
+ * @brief Pins the tick and server threads to CPUs and gives them real-time priority.
+ */
+struct RealtimeParams {
+    std::vector<int> tick_cpus;   // CPUs of the fleet scheduler and its pool; empty = any
+    std::vector<int> server_cpus; // CPUs of the Modbus and RTU server threads; empty = any
+    SchedulingPolicy policy = SchedulingPolicy::Other;
+    int priority = 0;             // 1-99 with fifo or rr
+    bool lock_memory = false;     // mlockall the whole process
+};
+
+class RegisterSchema;
+
+/**
+ * @struct DeviceTemplate
+ * @brief Register schema and physics parameters shared read-only by every device built from it.
+ */
+struct DeviceTemplate {
+    std::string name;
+    SimulationParams sim_params;
+    ResponseModelParams response_model;
+    std::shared_ptr<const std::vector<Register>> registers;
+    std::shared_ptr<const RegisterSchema> schema; // Compact layout of registers, see register_schema.hpp
+};
+
+/**
+ * @struct DeviceConfig
+ * @brief One simulated device: a template plus the few values that differ per device.
+ */
+struct DeviceConfig {
+    DeviceIdentity identity;
+    double max_power_watts;
+    double azimuth_degrees; // Panel orientation, 180 = due south
+    std::shared_ptr<const DeviceTemplate> device_template;
+};
+
 /**
  * @struct Config
  * @brief Top-level structure to hold the entire parsed configuration.
  */
 struct Config {
-    DeviceIdentity identity;
-    SimulationParams sim_params;
-    std::vector<Register> registers;
+    std::vector<DeviceConfig> devices;
+    SharedMemoryParams shared_memory;
+    ChangeFeedParams change_feed;
+    AdminSocketParams admin_socket;
+    HistoryParams history;
+    ColumnarExportParams columnar_export;
+    TrafficCaptureParams traffic_capture;
+    std::vector<ModbusListenerParams> listeners; // Defaults to TCP on 127.0.0.1:1502 unless port_per_device is on
+    PortPerDeviceParams port_per_device;
+    RateLimitParams rate_limit;
+    std::vector<RtuBusParams> rtu_buses;
+    HotReloadParams hot_reload;
+    SchedulerParams scheduler;
+    MemoryArenaParams memory_arena;
+    RealtimeParams realtime;
 };
 
 #endif // DIGITAL_TWIN_H
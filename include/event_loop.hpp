@@ -0,0 +1,121 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class EventLoop
+ * @brief Single-threaded epoll loop with one-shot timers driven by a timerfd.
+ *
+ * File descriptors and timers are registered from the loop thread (or before
+ * run() starts); their callbacks run on the loop thread. Timers are kept in a
+ * min-heap and the timerfd is always armed for the earliest deadline, so no
+ * thread ever sleeps for a fixed interval. stop() and post() may be called
+ * from any thread.
+ */
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+    using FdHandler = std::function<void(uint32_t events)>;
+    using TimerId = uint64_t;
+
+    EventLoop();
+
+    /**
+     * @brief Destructor, closes the loop's descriptors (registered fds are not closed).
+     */
+    ~EventLoop();
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    /**
+     * @brief Creates the epoll, timer and wake descriptors.
+     * @return True on success, false on failure.
+     */
+    bool open();
+
+    /**
+     * @brief Dispatches events on the calling thread until stop() is called.
+     */
+    void run();
+
+    /**
+     * @brief Makes run() return after the current dispatch round.
+     * @note Safe to call from any thread.
+     */
+    void stop();
+
+    /**
+     * @brief Runs a callback on the loop thread during the next dispatch round.
+     * @note Safe to call from any thread; this is how other threads hand results to the loop.
+     */
+    void post(std::function<void()> callback);
+
+    /**
+     * @brief Watches a descriptor.
+     * @param fd The descriptor, which should be non-blocking.
+     * @param events EPOLLIN / EPOLLOUT / ... mask.
+     * @param handler Called with the returned events.
+     * @return True on success, false on failure.
+     */
+    bool addFd(int fd, uint32_t events, FdHandler handler);
+
+    /**
+     * @brief Changes the event mask of a watched descriptor.
+     */
+    bool modifyFd(int fd, uint32_t events);
+
+    /**
+     * @brief Stops watching a descriptor; safe to call from its own handler.
+     */
+    void removeFd(int fd);
+
+    /**
+     * @brief Schedules a one-shot callback.
+     * @param deadline When to run it; deadlines in the past run on the next dispatch round.
+     * @return An id for cancelTimer().
+     */
+    TimerId addTimer(Clock::time_point deadline, std::function<void()> callback);
+
+    /**
+     * @brief Cancels a pending timer; unknown or already fired ids are ignored.
+     */
+    void cancelTimer(TimerId id);
+
+private:
+    struct Timer {
+        Clock::time_point deadline;
+        TimerId id;
+        bool operator>(const Timer& other) const {
+            return deadline != other.deadline ? deadline > other.deadline : id > other.id;
+        }
+    };
+
+    void armTimerFd();
+    void runDueTimers();
+    void runPosted();
+
+    int epoll_fd;
+    int timer_fd;
+    int wake_fd;
+    std::atomic<bool> running;
+
+    std::unordered_map<int, std::shared_ptr<FdHandler>> handlers; // Shared so a handler may remove itself
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    std::unordered_map<TimerId, std::function<void()>> timer_callbacks; // Pending timers; cancelled ones are erased
+    TimerId next_timer_id;
+    Clock::time_point armed_deadline;
+    std::mutex posted_mutex;
+    std::vector<std::function<void()>> posted; // Guarded by posted_mutex
+};
+
+#endif // EVENT_LOOP_H
@@ -0,0 +1,124 @@
+#ifndef FLEET_SCHEDULER_H
+#define FLEET_SCHEDULER_H
+
+#include "numa_topology.hpp"
+#include "simulation_engine.hpp"
+#include "timer_wheel.hpp"
+#include "work_stealing_pool.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class FleetScheduler
+ * @brief Runs the ticks of every simulated device on one work-stealing thread pool.
+ *
+ * Every device's next tick waits in a timer wheel, so finding the due devices
+ * costs O(1) per device ticked rather than a scan of the fleet. A scheduler
+ * thread sleeps until the wheel's earliest deadline, then ticks all due
+ * devices as one round: the devices are split into chunks small enough for
+ * their state to stay in a core's cache, every chunk's update() runs on the
+ * pool, and after a barrier every chunk's publish() commits the new snapshot
+ * generations, so a round's devices become visible together. Commands posted
+ * to an engine run on the scheduler thread between rounds.
+ *
+ * Devices can be given phase offsets within their update interval, evenly
+ * spread or random, so a large fleet ticks (and publishes, and invalidates
+ * caches) in many small rounds instead of one burst per interval.
+ *
+ * A fleet of any size costs threads equal to the pool size instead of one
+ * thread per device, and a round's wall time shrinks with the core count.
+ *
+ * On a multi-socket host the fleet can be split into shards, one per NUMA
+ * node. Each shard has its own scheduler thread and pool, bound to the CPUs
+ * of its node, so a device is only ever ticked by the node holding its
+ * memory, and rounds of different shards do not wait for each other.
+ *
+ * Scheduler and pool threads take the CPUs and scheduling policy of their
+ * shard's placement. How late rounds start after their due time (the tick
+ * jitter) is tracked over the most recent rounds and reported in metrics().
+ */
+class FleetScheduler {
+public:
+    /// Counters since start().
+    struct Metrics {
+        uint64_t rounds;        // Wake-ups that ticked at least one device
+        uint64_t ticks;         // Device ticks
+        size_t shards;
+        size_t threads;         // Pool sizes, the scheduler threads included
+        uint64_t steals;        // Chunks run by a thread other than their owner
+        double last_round_ms;   // Wall time of the last round, update and publish; the longest over shards
+        double max_round_ms;
+        double max_lateness_ms; // How late a round started after its earliest due tick
+        double lateness_p50_ms; // Median and 99th percentile lateness of the recent rounds
+        double lateness_p99_ms;
+    };
+
+    /**
+     * @param engines The engines to tick; they must outlive the scheduler.
+     * @param params Total pool size, scheduler threads included, shared out by shard size (0 uses
+     *               every core of each shard's node), and the tick phases.
+     * @param shards Ranges of engines per NUMA node; empty runs one unbound shard.
+     */
+    FleetScheduler(std::vector<SimulationEngine*> engines, const SchedulerParams& params,
+                   std::vector<FleetShard> shards = {});
+
+    /**
+     * @brief Destructor, ensures the scheduler is stopped.
+     */
+    ~FleetScheduler();
+
+    /**
+     * @brief Starts ticking; every device ticks at its phase offset from now, then at its update interval.
+     */
+    void start();
+
+    /**
+     * @brief Stops after the current round; returns in milliseconds.
+     */
+    void stop();
+
+    /**
+     * @note Safe to call from any thread.
+     */
+    Metrics metrics() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Shard {
+        FleetShard range;
+        size_t thread_count;
+        std::unique_ptr<WorkStealingPool> pool;
+        std::thread scheduler_thread;
+        // Scheduler thread only
+        std::unique_ptr<TimerWheel> wheel;       // Holds one entry per engine: its next tick
+        std::vector<Clock::time_point> next_due; // Per engine of the shard
+        std::vector<size_t> due;                 // Engines ticked in the current round
+
+        std::mutex wake_mutex;
+        std::condition_variable wake;
+        bool running = false;                            // Guarded by wake_mutex
+        std::vector<SimulationEngine*> pending_commands; // Guarded by wake_mutex
+
+        Metrics stats{};                    // Guarded by metrics_mutex
+        std::vector<double> lateness_ms;    // Guarded by metrics_mutex; ring of the recent rounds
+        size_t lateness_next = 0;
+    };
+
+    void run(Shard& shard);
+    void runRound(Shard& shard, Clock::time_point now);
+    void scheduleTick(Shard& shard, size_t index);
+
+    std::vector<SimulationEngine*> engines;
+    std::vector<std::unique_ptr<Shard>> shards;
+    TickPhase phase;
+    bool started;
+    mutable std::mutex metrics_mutex;
+};
+
+#endif // FLEET_SCHEDULER_H
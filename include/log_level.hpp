@@ -0,0 +1,21 @@
+#ifndef LOG_LEVEL_H
+#define LOG_LEVEL_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief Verbosity of the runtime event messages (weather, faults, client connections).
+ *
+ * Startup output and errors are always printed. The level can be changed at
+ * runtime through the admin socket; checks are a relaxed atomic load.
+ */
+enum class LogLevel : uint8_t { Error, Warning, Info, Debug };
+
+inline std::atomic<LogLevel> g_log_level{LogLevel::Info};
+
+inline bool logEnabled(LogLevel level) {
+    return level <= g_log_level.load(std::memory_order_relaxed);
+}
+
+#endif // LOG_LEVEL_H
@@ -0,0 +1,62 @@
+#ifndef MODBUS_REQUEST_HANDLER_H
+#define MODBUS_REQUEST_HANDLER_H
+
+#include "digital_twin.hpp"
+#include "safe_data_model.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @class ModbusRequestHandler
+ * @brief Executes Modbus request PDUs against the data model and builds the response PDUs.
+ *
+ * The handler works on bare PDUs (function code + data), so it is independent
+ * of the transport framing. Supported function codes are 0x03/0x04 (read
+ * holding/input registers), 0x06 (write single register), 0x10 (write
+ * multiple registers), 0x17 (read/write multiple registers, applied
+ * atomically) and 0x2B/0x0E (read device identification, built from the
+ * DeviceIdentity); anything else yields an ILLEGAL FUNCTION exception.
+ */
+class ModbusRequestHandler {
+public:
+    /// Largest PDU allowed by the Modbus specification.
+    static constexpr size_t MAX_PDU_LENGTH = 253;
+
+    /**
+     * @brief Constructor for the ModbusRequestHandler.
+     * @param data_model A shared pointer to the thread-safe data model.
+     * @param identity The device's identity, reported by Read Device Identification.
+     */
+    ModbusRequestHandler(std::shared_ptr<SafeDataModel> data_model, const DeviceIdentity& identity);
+
+    /**
+     * @brief Processes one request PDU.
+     * @param request The request PDU, starting with the function code.
+     * @param length Number of bytes in request.
+     * @param response Buffer of at least MAX_PDU_LENGTH bytes for the response PDU.
+     * @return Length of the response PDU written to response.
+     */
+    size_t handle(const uint8_t* request, size_t length, uint8_t* response);
+
+    /**
+     * @brief Builds an exception response PDU.
+     * @return Length of the response PDU (always 2).
+     */
+    static size_t exception(uint8_t function_code, uint8_t exception_code, uint8_t* response);
+
+private:
+    size_t readRegisters(const uint8_t* request, size_t length, uint8_t* response);
+    size_t writeSingleRegister(const uint8_t* request, size_t length, uint8_t* response);
+    size_t writeMultipleRegisters(const uint8_t* request, size_t length, uint8_t* response);
+    size_t writeAndReadRegisters(const uint8_t* request, size_t length, uint8_t* response);
+    size_t readDeviceIdentification(const uint8_t* request, size_t length, uint8_t* response);
+
+    std::shared_ptr<SafeDataModel> data_model;
+    std::vector<std::pair<uint8_t, std::string>> identification_objects; // Ascending object ID
+};
+
+#endif // MODBUS_REQUEST_HANDLER_H
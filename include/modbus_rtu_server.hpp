@@ -0,0 +1,94 @@
+#ifndef MODBUS_RTU_SERVER_H
+#define MODBUS_RTU_SERVER_H
+
+#include "digital_twin.hpp"
+#include "event_loop.hpp"
+#include "modbus_request_handler.hpp"
+#include "safe_data_model.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @class ModbusRtuServer
+ * @brief Serves Modbus RTU on virtual RS-485 buses, one pseudo-terminal per bus.
+ *
+ * Each bus is a pty pair; clients open the slave side through a symlink and
+ * talk RTU as they would to a USB/RS-485 adapter. Several unit IDs can share a
+ * bus. The serial line is modelled on a single EventLoop thread for all buses:
+ * request bytes are assigned wire time at the configured baud rate, a frame
+ * ends after a 3.5-character silence (1.75 ms above 19200 baud), the CRC is
+ * checked, and responses are released to the client paced at the baud rate.
+ * Frames with a bad CRC or for unknown units are dropped silently, as on a
+ * real bus; broadcasts (unit 0) are executed without a reply.
+ */
+class ModbusRtuServer {
+public:
+    ModbusRtuServer();
+
+    /**
+     * @brief Destructor, stops the loop and removes the bus symlinks.
+     */
+    ~ModbusRtuServer();
+
+    /**
+     * @brief Creates the pty for a bus.
+     * @param params Serial settings and the symlink path of the bus.
+     * @param devices The devices served on the bus (selected by their unit IDs) and their data models.
+     * @return True on success, false on failure.
+     * @note Must be called before start().
+     */
+    bool addBus(const RtuBusParams& params,
+                const std::vector<std::pair<DeviceIdentity, std::shared_ptr<SafeDataModel>>>& devices);
+
+    /**
+     * @brief Starts the event loop thread serving every bus.
+     * @return True on success, false on failure.
+     */
+    bool start();
+
+    /**
+     * @brief Stops the event loop thread.
+     */
+    void stop();
+
+private:
+    using Clock = EventLoop::Clock;
+
+    struct Bus {
+        RtuBusParams params;
+        int master_fd = -1;
+        int slave_fd = -1; // Held open so the master does not see a hangup between client sessions
+        std::array<std::unique_ptr<ModbusRequestHandler>, 248> handlers;
+        std::chrono::nanoseconds char_time{0};
+        std::chrono::nanoseconds frame_gap{0};
+
+        // Receive side: bytes of the frame in progress and when its last byte left the simulated wire
+        std::vector<uint8_t> rx;
+        Clock::time_point rx_wire_end;
+        EventLoop::TimerId gap_timer = 0;
+
+        // Transmit side: the response being clocked out
+        std::vector<uint8_t> tx;
+        size_t tx_sent = 0;
+        Clock::time_point tx_start;
+
+        uint64_t requests = 0;
+        uint64_t crc_errors = 0;
+    };
+
+    void onReadable(Bus& bus);
+    void onFrameComplete(Bus& bus);
+    void transmit(Bus& bus);
+
+    EventLoop loop;
+    std::vector<std::unique_ptr<Bus>> buses;
+    std::thread loop_thread;
+    std::atomic<bool> running;
+};
+
+#endif // MODBUS_RTU_SERVER_H
@@ -1,28 +1,84 @@
 #ifndef MODBUS_SERVER_H
 #define MODBUS_SERVER_H
 
+#include "buffer_pool.hpp"
+#include "digital_twin.hpp"
+#include "event_loop.hpp"
 #include "safe_data_model.hpp"
+#include "modbus_request_handler.hpp"
+#include "timer_wheel.hpp"
+#include "traffic_capture.hpp"
 #include <thread>
+#include <array>
 #include <atomic>
 #include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
 #include <modbus/modbus.h>
 
 /**
  * @class ModbusServer
- * @brief Handles Modbus TCP communication in a dedicated thread.
+ * @brief Serves Modbus over TCP, UDP and Unix domain sockets from one event loop thread.
  *
- * This class uses libmodbus to create a Modbus TCP server. It listens for
- * client requests, interacts with the SafeDataModel to read or write register
- * data, and sends responses back to the client.
+ * Every transport carries MBAP frames and shares one request core: the
+ * frame's PDU is executed by a ModbusRequestHandler against the SafeDataModel,
+ * and the response frame is assembled here so it can optionally be recorded
+ * by a TrafficCapture. Stream transports (TCP, Unix) reassemble frames per
+ * connection and serve any number of clients concurrently; UDP carries one
+ * frame per datagram and answers the sender.
+ *
+ * Several devices can share one server; requests are dispatched on the MBAP
+ * unit identifier. A server with a single device answers every unit ID, as
+ * a standalone inverter does. Alternatively a device can get a dedicated
+ * listener (port-per-device mode), which answers every unit ID for that
+ * device only; thousands of such listeners cost one descriptor each on the
+ * same loop thread.
+ *
+ * Connections are served round-robin, a bounded number of frames per turn,
+ * so one pipelining client cannot starve the others. Sockets never block:
+ * responses a client does not accept wait in a fixed-size output block from
+ * a slab pool, the connection is not read while they do, and a client whose
+ * unsent responses outgrow the block, or that accepts none of them for a
+ * while, is disconnected. Optional token buckets
+ * per connection and per client address shed excess requests with exception
+ * 06 (server busy) before they reach the data model.
+ *
+ * A device's response model (latency distribution, loss, disconnects) is
+ * applied by parking its responses in a timer wheel on the loop thread;
+ * nothing ever sleeps, so thousands of delayed responses cost one wheel
+ * entry each. Responses on a connection keep their request order.
  */
 class ModbusServer {
 public:
+    /// Counters since start, as seen by the loop thread.
+    struct Metrics {
+        uint64_t requests;
+        uint64_t shed;            // Answered with exception 06 by rate limits
+        uint64_t lost;            // Dropped by response models
+        uint64_t disconnects;     // Connections closed by response models
+        uint64_t slow_clients;    // Disconnected for not reading their responses
+        uint64_t connections;     // Connections accepted so far, plus one per UDP listener
+        size_t open_connections;
+        size_t parked_responses;  // Waiting in the response wheel
+        size_t output_blocks;     // Output blocks held by connections
+    };
+
     /**
      * @brief Constructor for the ModbusServer.
      * @param data_model A shared pointer to the thread-safe data model.
-     * @param unit_id The Modbus unit ID for the server.
+     * @param device The device's configuration; its unit ID selects the device.
+     */
+    ModbusServer(std::shared_ptr<SafeDataModel> data_model, const DeviceConfig& device);
+
+    /**
+     * @brief Serves another device behind the same listeners.
+     * @param device The device's configuration; its unit ID selects the device.
+     * @param data_model The device's data model.
+     * @return False if the unit ID is out of range or already taken.
+     * @note Must be called before start().
      */
-    ModbusServer(std::shared_ptr<SafeDataModel> data_model, int unit_id);
+    bool addDevice(const DeviceConfig& device, std::shared_ptr<SafeDataModel> data_model);
 
     /**
      * @brief Destructor, ensures the server is stopped.
@@ -30,34 +86,168 @@ public:
     ~ModbusServer();
 
     /**
-     * @brief Starts the Modbus server listening loop in a new thread.
-     * @param port The TCP port to listen on.
+     * @brief Binds a listening socket.
+     * @param params Transport and address of the listener.
+     * @return True on success, false on failure.
+     * @note Must be called before start().
+     */
+    bool addListener(const ModbusListenerParams& params);
+
+    /**
+     * @brief Binds a listening socket dedicated to one device.
+     * @param params Transport and address of the listener.
+     * @param device The configuration of the device served on it.
+     * @param data_model The device served on it, whatever unit ID a request carries.
+     * @return True on success, false on failure.
+     * @note Must be called before start().
+     */
+    bool addDeviceListener(const ModbusListenerParams& params, const DeviceConfig& device,
+                           std::shared_ptr<SafeDataModel> data_model);
+
+    /**
+     * @brief Starts serving every listener in a new thread.
      * @return True on success, false on failure.
      */
-    bool start(int port);
+    bool start();
 
     /**
      * @brief Stops the Modbus server.
      */
     void stop();
 
+    /**
+     * @brief Enables per-connection and per-client-address request rate limits.
+     * @note Must be called before start().
+     */
+    void setRateLimit(const RateLimitParams& params);
+
+    /**
+     * @brief Records every request and response frame into the given capture.
+     * @note Must be called before start().
+     */
+    void setTrafficCapture(std::shared_ptr<TrafficCapture> capture);
+
+    /**
+     * @brief Reads the counters on the loop thread and hands them to done there.
+     * @note Safe to call from any thread; done must not block.
+     */
+    void queryMetrics(std::function<void(const Metrics&)> done);
+
 private:
+    using Clock = EventLoop::Clock;
+
+    struct TokenBucket {
+        double tokens = 0;
+        Clock::time_point last_refill;
+
+        /// Refills for the time elapsed since the last call and takes one token if available; O(1).
+        bool take(double rate, double burst, Clock::time_point now);
+    };
+
+    struct Device {
+        std::unique_ptr<ModbusRequestHandler> handler;
+        ResponseModelParams response_model;
+        bool simulated_timing; // Whether response_model delays, drops or disconnects anything
+    };
+
+    /// What the response model decided for one request.
+    enum class Fate { Reply, Lose, Disconnect };
+
+    struct Source {
+        TokenBucket bucket;
+        uint32_t connections = 0; // Open connections from this address; UDP senders have none
+    };
+
+    struct Listener {
+        ModbusListenerParams params;
+        int fd;
+        uint32_t connection_id; // UDP: all datagrams of a listener are captured as one connection
+        std::unique_ptr<Device> device; // Port-per-device; null dispatches on unit ID
+    };
+
+    struct Connection {
+        int fd;
+        uint32_t id;
+        Device* device;
+        uint64_t source;         // Key into sources
+        TokenBucket bucket;
+        uint32_t events;         // Current epoll interest
+        EventLoop::TimerId resume_timer = 0; // Set while queued for another turn
+        EventLoop::TimerId stall_timer = 0;  // Set while responses wait for the socket
+        Clock::time_point last_progress;     // Last time the socket accepted waiting responses
+        uint32_t parked = 0;                 // Responses waiting in the timer wheel
+        Clock::time_point last_release;      // Release time of the newest parked response
+        std::vector<uint8_t> rx; // Bytes of frames not served yet; empty and unallocated when idle
+        uint8_t* tx = nullptr;   // Output block from output_pool, held only while bytes are unsent
+        uint32_t tx_begin = 0;   // Unsent bytes are tx[tx_begin, tx_end)
+        uint32_t tx_end = 0;
+
+        size_t unsent() const {
+            return tx_end - tx_begin;
+        }
+    };
+
+    int bindListener(const ModbusListenerParams& params);
+    void onAccept(Listener& listener);
+    void onDatagram(Listener& listener);
+    void onConnectionEvent(Connection& connection, uint32_t events);
+    /// Serves frames from data, which is either connection.rx or a read buffer whose remainder goes into rx.
+    void serve(Connection& connection, const uint8_t* data, size_t size);
+    void updateInterest(Connection& connection);
+    void armStallTimer(Connection& connection);
+    void closeConnection(Connection& connection);
+    bool flush(Connection& connection);
+    bool queueReply(Connection& connection, const uint8_t* reply, size_t length);
+
+    Source& sourceFor(uint64_t key, Clock::time_point now);
+    bool admit(TokenBucket* connection_bucket, Source& source, Clock::time_point now);
+
+    std::unique_ptr<Device> makeDevice(const DeviceConfig& config, std::shared_ptr<SafeDataModel> data_model);
+    Fate decideFate(const Device* device, Clock::duration& latency);
+    void park(Clock::time_point release, TimerWheel::Callback callback);
+    void armWheel();
+    void parkReply(Connection& connection, Clock::duration latency, const uint8_t* reply, size_t length);
+
     /**
-     * @brief The main loop of the Modbus server thread.
+     * @brief Counts a received MBAP request frame and adds it to the traffic capture.
      */
-    void run();
+    void recordRequest(uint32_t connection_id, const uint8_t* query, size_t length);
+
+    /**
+     * @brief Executes one MBAP request frame, recorded beforehand, and builds the response frame.
+     * @param shed Answer with a server-busy exception instead of executing the request.
+     * @return Length of the response frame written to reply.
+     */
+    size_t processFrame(uint32_t connection_id, Device* device, bool shed, const uint8_t* query, size_t length,
+                        uint8_t* reply);
 
     uint16_t protocolToInternal(uint16_t protocol_addr, int function_code = 0x04);
     uint16_t internalToProtocol(uint16_t internal_addr, int function_code = 0x04);
 
-    std::shared_ptr<SafeDataModel> data_model;
-    int unit_id;
-    int port;
-    modbus_t *ctx;
-    modbus_mapping_t *mb_mapping;
+    Device* deviceFor(uint8_t unit_id);
+    Metrics metrics() const;
+
+    std::array<std::unique_ptr<Device>, 256> devices; // Indexed by unit ID
+    size_t device_count;
+    Device* first_device;
+    std::shared_ptr<TrafficCapture> traffic_capture;
+    RateLimitParams rate_limit;
+    std::unordered_map<uint64_t, Source> sources; // Per client address, only used with rate limits
+    uint64_t request_count;
+    uint64_t shed_count;
+    uint64_t lost_count;
+    uint64_t disconnect_count;
+    uint64_t overflow_count;
+    EventLoop loop;
+    BufferPool output_pool; // Output blocks of connections with unsent responses
+    TimerWheel response_wheel; // Parked responses of devices with a response model
+    EventLoop::TimerId wheel_timer;
+    std::mt19937_64 random_engine;
+    std::vector<std::unique_ptr<Listener>> listeners;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections; // Indexed by socket
     std::thread server_thread;
     std::atomic<bool> running;
-    int server_socket;
+    uint32_t connection_count;
 };
 
 #endif // MODBUS_SERVER_H
@@ -0,0 +1,102 @@
+#ifndef NUMA_TOPOLOGY_H
+#define NUMA_TOPOLOGY_H
+
+#include "digital_twin.hpp"
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @struct NumaNode
+ * @brief A NUMA node and the CPUs of it this process may run on.
+ */
+struct NumaNode {
+    int id;
+    std::vector<int> cpus;
+};
+
+/**
+ * @struct ThreadPlacement
+ * @brief Where and at which priority a thread runs.
+ */
+struct ThreadPlacement {
+    std::vector<int> cpus; // Empty: not pinned
+    SchedulingPolicy policy = SchedulingPolicy::Other;
+    int priority = 0;
+};
+
+/**
+ * @struct FleetShard
+ * @brief A contiguous range of devices owned by one NUMA node.
+ */
+struct FleetShard {
+    int node;
+    ThreadPlacement placement; // The node's CPUs unless narrowed by configuration
+    size_t first;              // Index of the first device
+    size_t count;
+};
+
+/**
+ * @class NumaTopology
+ * @brief Reads the machine's NUMA layout and places threads and memory on CPUs and nodes.
+ *
+ * The layout comes from /sys/devices/system/node, so no NUMA library is
+ * needed. Memory is placed by first touch: the kernel backs a page on the
+ * node of the CPU that first writes it, and glibc gives every thread its own
+ * malloc arena, so whatever a thread bound to a node allocates and
+ * initializes ends up on that node.
+ */
+class NumaTopology {
+public:
+    /**
+     * @brief Lists the nodes that have CPUs this process may use.
+     * @return One entry per node; a single node with every usable CPU if the system reports none.
+     */
+    static std::vector<NumaNode> detect();
+
+    /**
+     * @brief Splits devices [0, device_count) into one contiguous shard per node, sized by its CPU count.
+     * @return Only shards that own at least one device.
+     */
+    static std::vector<FleetShard> partition(const std::vector<NumaNode>& nodes, size_t device_count);
+
+    /**
+     * @brief Restricts the calling thread to the given CPUs; threads it starts later inherit the mask.
+     * @return True on success (or if cpus is empty), false on failure.
+     */
+    static bool bindCurrentThread(const std::vector<int>& cpus);
+
+    /**
+     * @brief Binds the calling thread to the placement's CPUs and applies its scheduling policy.
+     *
+     * Threads it starts later inherit both. A real-time policy needs
+     * CAP_SYS_NICE or an RLIMIT_RTPRIO; without them a warning is printed
+     * once and the thread keeps the default policy.
+     * @return False if either step failed.
+     */
+    static bool placeCurrentThread(const ThreadPlacement& placement);
+
+    /**
+     * @brief Narrows a node's CPUs to the configured ones.
+     * @param node_cpus The node's CPUs; empty stands for every CPU.
+     * @param wanted The configured CPUs; empty keeps node_cpus.
+     * @return The CPUs in both; wanted, with a warning, if they have none in common.
+     */
+    static std::vector<int> restrictCpus(const std::vector<int>& node_cpus, const std::vector<int>& wanted);
+
+    /**
+     * @brief Runs task on a temporary thread with the given placement and waits for it.
+     *
+     * Everything the task allocates and initializes is placed on the CPUs'
+     * node, and threads it starts keep running there.
+     */
+    static void runOn(const ThreadPlacement& placement, const std::function<void()>& task);
+
+    /**
+     * @brief Parses a kernel CPU list such as "0-3,8-11".
+     */
+    static std::vector<int> parseCpuList(const std::string& list);
+};
+
+#endif // NUMA_TOPOLOGY_H
@@ -0,0 +1,104 @@
+#ifndef REGISTER_HISTORY_H
+#define REGISTER_HISTORY_H
+
+#include "safe_data_model.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * @class RegisterHistory
+ * @brief Bounded, delta-encoded history of a device's register values.
+ *
+ * Each committed tick is stored as a frame holding only the registers that
+ * changed in it. Frames and their deltas live in two fixed-size rings; when
+ * either ring is full, the oldest frame is folded into a base image, so any
+ * register can be read at any retained generation or wall-clock time.
+ */
+class RegisterHistory {
+public:
+    /**
+     * @brief Constructor for the RegisterHistory.
+     * @param data_model A shared pointer to the initialized data model.
+     * @param max_frames Number of tick frames retained.
+     * @param max_changes Total number of register deltas retained across all frames.
+     */
+    RegisterHistory(std::shared_ptr<SafeDataModel> data_model, size_t max_frames, size_t max_changes);
+
+    /**
+     * @brief Appends the changes of a committed tick; intended as a tick listener.
+     * @param generation The generation returned by SafeDataModel::commitTick().
+     */
+    void record(uint64_t generation);
+
+    /**
+     * @brief Reads a 16-bit register as it was at a retained generation.
+     * @return True if the address is mapped and the generation is still retained.
+     */
+    bool readAt(uint16_t address, uint64_t generation, uint16_t& value);
+
+    /**
+     * @brief Reads a 16-bit register as it was at a wall-clock time (milliseconds since the epoch).
+     * @return True if the address is mapped and the time falls within the retained window.
+     */
+    bool readAtTime(uint16_t address, int64_t timestamp_ms, uint16_t& value);
+
+    /**
+     * @brief Finds the newest retained generation committed at or before a wall-clock time.
+     */
+    std::optional<uint64_t> generationAt(int64_t timestamp_ms);
+
+    /**
+     * @brief Gets the oldest and newest retained generations.
+     */
+    std::pair<uint64_t, uint64_t> retainedRange();
+
+    /**
+     * @brief Writes the retained history as CSV (generation,timestamp_ms,address,value).
+     *
+     * The first rows hold the full base image; every later row is a change.
+     * @param filename The output file path.
+     * @return True on success, false if the file could not be written.
+     */
+    bool exportCsv(const std::string& filename);
+
+private:
+    struct Frame {
+        uint64_t generation;
+        int64_t timestamp_ms;
+        size_t first_change; // Monotonic index into the change ring
+        uint32_t count;
+    };
+
+    void append(uint64_t generation, int64_t timestamp_ms, const std::vector<RegisterDelta>& changes);
+    void evictOldest();
+    void applyToBase(const RegisterDelta& change);
+    const Frame& frameAt(size_t index) const;
+    const RegisterDelta& changeAt(size_t index) const;
+    bool lookup(uint16_t address, uint64_t generation, uint16_t& value) const;
+
+    std::shared_ptr<SafeDataModel> data_model;
+    std::mutex history_mutex;
+
+    // Base image: state as of base_generation, before the oldest retained frame
+    std::vector<uint16_t> base_addresses;
+    std::vector<uint16_t> base_values;
+    uint64_t base_generation;
+    int64_t base_timestamp_ms;
+
+    std::vector<Frame> frames;
+    size_t frame_head;  // Index of the oldest frame
+    size_t frame_count;
+
+    std::vector<RegisterDelta> changes;
+    size_t change_head; // Monotonic index of the oldest retained change
+    size_t change_tail; // Monotonic index one past the newest change
+
+    uint64_t last_generation;
+    std::vector<RegisterDelta> scratch;
+};
+
+#endif // REGISTER_HISTORY_H
@@ -0,0 +1,126 @@
+#ifndef REGISTER_SCHEMA_H
+#define REGISTER_SCHEMA_H
+
+#include "digital_twin.hpp"
+#include <cstdint>
+#include <vector>
+#include <variant>
+
+/// @brief A logical register value, typed according to RegisterType.
+using RegisterValue = std::variant<uint16_t, int16_t, uint32_t, int32_t, uint64_t, int64_t>;
+
+/**
+ * @struct RegisterLayout
+ * @brief Immutable description of one logical register (8 bytes).
+ */
+struct RegisterLayout {
+    uint16_t address;    ///< Logical start address
+    uint16_t first_word; ///< Index of the first word in a device's word array
+    RegisterType type;
+    RegisterFormat format;
+    RegisterAccess access;
+    uint8_t num_regs;
+};
+
+/**
+ * @struct RegisterSpan
+ * @brief A run of consecutive mapped addresses, readable in one request.
+ */
+struct RegisterSpan {
+    uint16_t address;    ///< First Modbus address of the span
+    uint16_t first_word; ///< Word index of that address
+    uint32_t word_count;
+};
+
+/**
+ * @class RegisterSchema
+ * @brief The register layout of a device template, built once and shared read-only by its devices.
+ *
+ * Registers are laid out in ascending address order in a packed array of
+ * 16-bit words, so a device only has to store wordCount() values. Lookups
+ * from a Modbus address to its word (and from a word to its register) go
+ * through flat tables and are O(1). Consecutive addresses are grouped into
+ * spans, which map to consecutive words, so a range read that stays within
+ * one span is a single copy.
+ */
+class RegisterSchema {
+public:
+    /// Marks an address without a word in wordIndex().
+    static constexpr uint16_t UNMAPPED = 0xFFFF;
+
+    /**
+     * @brief Builds the schema and the initial word image.
+     * @param registers The registers parsed from the profile, free of overlaps
+     *        (see ConfigLoader::validateRegisters()).
+     * @throw std::runtime_error if the registers need more than 65535 words.
+     */
+    explicit RegisterSchema(const std::vector<Register>& registers);
+
+    /**
+     * @brief Number of 16-bit words a device using this schema stores.
+     */
+    size_t wordCount() const { return word_addresses.size(); }
+
+    /**
+     * @brief All logical registers in ascending address order.
+     */
+    const std::vector<RegisterLayout>& registers() const { return layouts; }
+
+    /**
+     * @brief Finds the logical register starting at the given address.
+     * @return The register, or nullptr if no register starts there.
+     */
+    const RegisterLayout* findRegister(uint16_t address) const;
+
+    /**
+     * @brief The contiguous readable spans in ascending address order.
+     */
+    const std::vector<RegisterSpan>& spans() const { return span_table; }
+
+    /**
+     * @brief Finds the span containing an address in O(log spans).
+     * @return The span, or nullptr if the address is unmapped.
+     */
+    const RegisterSpan* findSpan(uint16_t address) const;
+
+    /**
+     * @brief Maps a Modbus address to its word index, or UNMAPPED.
+     */
+    uint16_t wordIndex(uint16_t address) const { return address_index[address]; }
+
+    /**
+     * @brief The logical register a word belongs to.
+     */
+    const RegisterLayout& registerOfWord(uint16_t index) const { return layouts[word_register[index]]; }
+
+    /**
+     * @brief Modbus address of every word, in word (and address) order.
+     */
+    const std::vector<uint16_t>& wordAddresses() const { return word_addresses; }
+
+    /**
+     * @brief The profile's initial values as a word image.
+     */
+    const std::vector<uint16_t>& initialWords() const { return initial_words; }
+
+    /**
+     * @brief Splits a logical value into big-endian Modbus words.
+     * @param words Output with room for layout.num_regs words.
+     */
+    static void encodeValue(const RegisterLayout& layout, const RegisterValue& value, uint16_t* words);
+
+    /**
+     * @brief Reassembles a logical value from its big-endian Modbus words.
+     */
+    static RegisterValue decodeValue(const RegisterLayout& layout, const uint16_t* words);
+
+private:
+    std::vector<RegisterLayout> layouts;
+    std::vector<uint16_t> word_addresses;
+    std::vector<uint16_t> word_register; // Per word: index into layouts
+    std::vector<uint16_t> initial_words;
+    std::vector<uint16_t> address_index; // 65536 entries: word index or UNMAPPED
+    std::vector<RegisterSpan> span_table;
+};
+
+#endif // REGISTER_SCHEMA_H
@@ -2,27 +2,43 @@
 #define SAFE_DATA_MODEL_H
 
 #include "digital_twin.hpp"
+#include "memory_arena.hpp"
+#include "register_schema.hpp"
+#include <memory>
 #include <vector>
-#include <unordered_map>
 #include <mutex>
 #include <optional>
 #include <variant>
 
+/**
+ * @struct RegisterDelta
+ * @brief A single changed 16-bit Modbus register, as streamed by change feeds.
+ */
+struct RegisterDelta {
+    uint16_t address;
+    uint16_t value;
+};
+
 /**
  * @class SafeDataModel
  * @brief Manages the shared state of all Modbus registers with thread-safe access.
  *
  * This class acts as the central repository for the inverter's register data.
  * It uses a mutex to protect the data from concurrent access by the Modbus
- * server thread and the simulation engine thread.
+ * server threads and the fleet scheduler's threads. The register layout lives
+ * in a RegisterSchema shared by every device of a template; the model itself
+ * only holds the packed 16-bit word values and their change tracking, sized
+ * once at initialization and optionally carved from a MemoryArena.
  */
 class SafeDataModel {
 public:
     /**
-     * @brief Initializes the data model from the loaded configuration.
-     * @param initial_registers A vector of Register structs from the config file.
+     * @brief Initializes the data model with the schema's initial values.
+     * @param schema The register layout, shared read-only with other devices.
+     * @param arena Arena for the words and change tracking; nullptr uses the heap. Must outlive the model.
+     * @note Call once.
      */
-    void initialize(const std::vector<Register>& initial_registers);
+    void initialize(std::shared_ptr<const RegisterSchema> schema, MemoryArena* arena = nullptr);
 
     /**
      * @brief Gets the value of a single 16-bit Modbus register.
@@ -32,6 +48,15 @@ public:
      */
     bool getRegisterValue(uint16_t address, uint16_t& value);
 
+    /**
+     * @brief Reads consecutive 16-bit registers with a single lookup and copy.
+     * @param address The first Modbus address.
+     * @param count Number of registers to read.
+     * @param values Output array with room for count words.
+     * @return False unless the whole range lies within one contiguous span of the schema.
+     */
+    bool readRange(uint16_t address, uint16_t count, uint16_t* values);
+
     /**
      * @brief Sets the value of a single 16-bit Modbus register.
      * @param address The Modbus address of the register.
@@ -40,6 +65,36 @@ public:
      */
     bool setRegisterValue(uint16_t address, uint16_t value);
 
+    /**
+     * @brief Writes consecutive registers as one atomic step (Modbus FC16).
+     *
+     * The whole range is validated before anything is written, and all words
+     * are stored under one lock, so readers and ticks never see a partly
+     * written multi-register value.
+     * @param address The first Modbus address to write.
+     * @param count Number of registers to write; each must be mapped and writable.
+     * @param values The values to write.
+     * @return False, without writing anything, if any register is unmapped or read-only.
+     */
+    bool writeRange(uint16_t address, uint16_t count, const uint16_t* values);
+
+    /**
+     * @brief Writes consecutive registers, then reads a range, as one atomic step (Modbus FC23).
+     *
+     * Both ranges are validated before anything is written, and the write and
+     * the read happen under one lock, so the values read belong to the same
+     * snapshot generation that contains the write.
+     * @param write_address The first Modbus address to write.
+     * @param write_count Number of registers to write; each must be mapped and writable.
+     * @param write_values The values to write.
+     * @param read_address The first Modbus address to read.
+     * @param read_count Number of registers to read; must lie within one contiguous span.
+     * @param read_values Output array with room for read_count words.
+     * @return False, without writing anything, if either range is invalid.
+     */
+    bool writeReadRange(uint16_t write_address, uint16_t write_count, const uint16_t* write_values,
+                        uint16_t read_address, uint16_t read_count, uint16_t* read_values);
+
     /**
      * @brief Gets the value of a register by its logical address, handling multi-register values.
      * @param address The logical start address of the register.
@@ -54,11 +109,87 @@ public:
      */
     void setLogicalValue(uint16_t address, const std::variant<uint16_t, int16_t, uint32_t, int32_t, uint64_t, int64_t>& value);
 
+    /**
+     * @brief Reads several logical registers under a single lock, widened to int64.
+     * @param addresses Logical start addresses of the registers.
+     * @param values Output array with room for addresses.size() values; unknown addresses read as 0.
+     * @return The generation the values belong to.
+     */
+    uint64_t readLogicalValues(const std::vector<uint16_t>& addresses, int64_t* values);
+
+    /**
+     * @brief Marks the end of a simulation tick and advances the snapshot generation.
+     * @return The new generation number.
+     */
+    uint64_t commitTick();
+
+    /**
+     * @brief Gets the registers that changed in a committed tick.
+     * @param tick_generation The generation returned by commitTick().
+     * @param changes Filled with the registers changed in that tick.
+     * @return False if a newer tick has been committed since; use changesSince() instead.
+     */
+    bool getTickChanges(uint64_t tick_generation, std::vector<RegisterDelta>& changes);
+
+    /**
+     * @brief Gets every register whose value changed after the given generation.
+     *
+     * Changes are versioned per block of VERSION_BLOCK_WORDS words, so unchanged
+     * neighbours of a changed register may be included with their current value.
+     * @param since The last generation the caller has seen (0 for a full image).
+     * @param changes Filled with the changed registers in ascending address order.
+     * @return The current generation.
+     */
+    uint64_t changesSince(uint64_t since, std::vector<RegisterDelta>& changes);
+
+    /**
+     * @brief Gets the generation of the most recently committed tick.
+     */
+    uint64_t getGeneration();
+
+    /**
+     * @brief Lists every mapped 16-bit Modbus address in ascending order.
+     */
+    std::vector<uint16_t> getModbusAddresses();
+
+    /**
+     * @brief Copies a set of 16-bit registers under a single lock.
+     * @param addresses The Modbus addresses to read.
+     * @param values Output array with room for addresses.size() words; unmapped addresses read as 0.
+     * @return The generation the copied values belong to.
+     */
+    uint64_t readRegisters(const std::vector<uint16_t>& addresses, uint16_t* values);
 
 private:
+    /// Words sharing one version stamp; keeps per-device change tracking a fraction of the values.
+    static constexpr size_t VERSION_BLOCK_WORDS = 16;
+
+    /**
+     * @brief Checks that every register of a write range is mapped and writable.
+     * @note The caller must hold data_mutex.
+     */
+    bool isWritableRange(uint16_t address, uint16_t count) const;
+
+    /**
+     * @brief Stores a 16-bit word and marks it dirty for the current tick if it changed.
+     * @note The caller must hold data_mutex.
+     */
+    void storeWord(uint16_t index, uint16_t value);
+
     std::mutex data_mutex;
-    std::unordered_map<uint16_t, Register> logical_register_map;
-    std::unordered_map<uint16_t, uint16_t> modbus_register_map;
+    std::shared_ptr<const RegisterSchema> schema;
+    template <typename T>
+    using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+    ArenaVector<uint16_t> words; // Indexed by schema word index
+    uint64_t generation = 0;
+
+    // Change tracking: dirty set of the tick in progress and per-block version stamps.
+    // The lists are reserved for every word up front, so they never reallocate.
+    ArenaVector<uint64_t> dirty_bitmap;
+    ArenaVector<uint16_t> dirty_words;
+    ArenaVector<RegisterDelta> last_tick_changes;
+    ArenaVector<uint64_t> block_versions;
 };
 
 #endif // SAFE_DATA_MODEL_H
@@ -0,0 +1,59 @@
+#ifndef SHARED_MEMORY_EXPORTER_H
+#define SHARED_MEMORY_EXPORTER_H
+
+#include "safe_data_model.hpp"
+#include "shared_register_image.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @class SharedMemoryExporter
+ * @brief Publishes a device's register image into a POSIX shared-memory segment.
+ *
+ * Co-located consumers map the segment read-only and read it with
+ * SharedRegisterImageHeader::readSnapshot() instead of polling over Modbus TCP.
+ * publish() is intended to be called from the simulation thread once per tick.
+ */
+class SharedMemoryExporter {
+public:
+    /**
+     * @brief Constructor for the SharedMemoryExporter.
+     * @param data_model A shared pointer to the thread-safe data model.
+     * @param identity The identity of the device being exported.
+     */
+    SharedMemoryExporter(std::shared_ptr<SafeDataModel> data_model, const DeviceIdentity& identity);
+
+    /**
+     * @brief Destructor, unmaps and unlinks the segment.
+     */
+    ~SharedMemoryExporter();
+
+    /**
+     * @brief Creates and maps the shared-memory segment.
+     * @param name The POSIX shared-memory object name (e.g. "/sma_twin").
+     * @return True on success, false on failure.
+     */
+    bool open(const std::string& name);
+
+    /**
+     * @brief Copies the current register values into the segment.
+     */
+    void publish();
+
+    /**
+     * @brief Unmaps and unlinks the segment.
+     */
+    void close();
+
+private:
+    std::shared_ptr<SafeDataModel> data_model;
+    DeviceIdentity identity;
+    std::string name;
+    std::vector<uint16_t> addresses;
+    std::vector<uint16_t> staging;
+    SharedRegisterImageHeader* header;
+    size_t segment_size;
+};
+
+#endif // SHARED_MEMORY_EXPORTER_H
@@ -0,0 +1,74 @@
+#ifndef SHARED_REGISTER_IMAGE_H
+#define SHARED_REGISTER_IMAGE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @struct SharedRegisterImageHeader
+ * @brief Layout of a device's register image published in POSIX shared memory.
+ *
+ * The header is followed by two arrays of register_count 16-bit words: the
+ * sorted Modbus addresses (fixed for the lifetime of the segment) and their
+ * current values. Writers bracket every update with the sequence counter
+ * (odd while an update is in progress), so readers can take a consistent
+ * snapshot without locks or system calls.
+ */
+struct SharedRegisterImageHeader {
+    static constexpr uint32_t MAGIC = 0x52414D53; // "SMAR"
+    static constexpr uint16_t VERSION = 1;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t register_count;
+    int32_t unit_id;
+    uint32_t serial_number;
+    uint32_t reserved;
+    std::atomic<uint64_t> sequence;
+    std::atomic<uint64_t> generation;
+    std::atomic<int64_t> timestamp_ms;
+
+    const uint16_t* addresses() const {
+        return reinterpret_cast<const uint16_t*>(reinterpret_cast<const uint8_t*>(this) + header_size);
+    }
+
+    const uint16_t* values() const {
+        return addresses() + register_count;
+    }
+
+    /**
+     * @brief Size in bytes of a segment holding the given number of registers.
+     */
+    static size_t segmentSize(uint32_t register_count) {
+        return sizeof(SharedRegisterImageHeader) + 2 * sizeof(uint16_t) * register_count;
+    }
+
+    /**
+     * @brief Copies the current values into the caller's buffer using the seqlock protocol.
+     * @param out Buffer with room for register_count words.
+     * @param out_generation Receives the generation of the copied values.
+     * @param max_attempts Number of retries before giving up on a busy writer.
+     * @return True if a consistent snapshot was taken.
+     */
+    bool readSnapshot(uint16_t* out, uint64_t& out_generation, int max_attempts = 1000) const {
+        for (int attempt = 0; attempt < max_attempts; ++attempt) {
+            uint64_t before = sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            std::memcpy(out, values(), register_count * sizeof(uint16_t));
+            out_generation = generation.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared-memory seqlock requires lock-free 64-bit atomics");
+
+#endif // SHARED_REGISTER_IMAGE_H
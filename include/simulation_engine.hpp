@@ -3,28 +3,142 @@
 
 #include "safe_data_model.hpp"
 #include "digital_twin.hpp"
-#include <thread>
-#include <atomic>
+#include <chrono>
+#include <ctime>
 #include <memory>
+#include <mutex>
 #include <random>
+#include <functional>
+#include <string>
+#include <vector>
 
+/**
+ * @class SimulationEngine
+ * @brief Simulates one device and writes its registers into its data model, one tick at a time.
+ *
+ * An engine has no thread of its own: a FleetScheduler calls update() and
+ * publish() for every tick and runs posted commands between ticks. The
+ * "simulation thread" below is whichever thread the scheduler runs the
+ * engine on; it never runs one engine on two threads at once.
+ */
 class SimulationEngine {
 public:
-    SimulationEngine(std::shared_ptr<SafeDataModel> data_model, const Config& config);
-    void start();
-    void stop();
+    /**
+     * @param data_model The data model of the simulated device.
+     * @param config The full configuration; shared by every engine of a fleet.
+     * @param device_index Index of the simulated device in config->devices.
+     */
+    SimulationEngine(std::shared_ptr<SafeDataModel> data_model, std::shared_ptr<const Config> config,
+                     size_t device_index = 0);
+
+    /**
+     * @brief First half of a tick: adopts a reloaded configuration and computes and writes the new state.
+     */
+    void update();
+
+    /**
+     * @brief Second half of a tick: commits the snapshot generation and notifies the tick listeners.
+     */
+    void publish();
+
+    /**
+     * @brief Gets the tick period; read between ticks.
+     */
+    uint32_t updateIntervalMs() const;
+
+    /**
+     * @brief Runs the commands queued by post(); called between ticks.
+     */
+    void runCommands();
+
+    /**
+     * @brief Sets the callback post() uses to have runCommands() called soon.
+     * @note Must be set before commands are posted.
+     */
+    void setCommandNotifier(std::function<void(SimulationEngine*)> notifier);
+
+    /**
+     * @brief Publishes a new configuration; the simulation thread adopts it at the start of its next tick.
+     * @param new_config A configuration already checked with ConfigLoader::isReloadCompatible().
+     * @note Safe to call from any thread.
+     */
+    void reloadConfig(std::shared_ptr<const Config> new_config);
+
+    /**
+     * @brief Registers a callback invoked on the simulation thread after every committed tick.
+     * @param listener Receives the generation of the tick that was just committed.
+     * @note Listeners must be added before the first tick.
+     */
+    void addTickListener(std::function<void(uint64_t)> listener);
+
+    /**
+     * @brief Queues a command to run on the simulation thread between ticks.
+     *
+     * Commands run in order, promptly (the scheduler is woken through the
+     * command notifier), and never during a tick, so they may call the
+     * between-ticks methods below.
+     * @note Safe to call from any thread; commands must not block.
+     */
+    void post(std::function<void()> command);
+
+    /// State of the engine, read on the simulation thread.
+    struct Status {
+        const DeviceConfig* device;
+        const char* state;
+        std::string weather;
+        double ac_power_watts;
+        double internal_temp_celsius;
+        uint64_t generation;    // Last committed tick
+        time_t simulated_time;
+        double clock_speed;
+    };
+
+    // Between-ticks methods, for commands passed to post()
+
+    Status status() const;
+
+    /**
+     * @brief Switches to the named weather model and holds it for weather_change_interval_seconds.
+     * @return False if the profile has no weather model of that name.
+     */
+    bool forceWeather(const std::string& name);
+
+    /**
+     * @brief Injects a fault (cleared like a random one, by acknowledging it) or clears the current one.
+     */
+    void forceFault(bool fault);
+
+    /**
+     * @brief Reads every register of the device, as of the last committed tick.
+     * @param addresses Filled with the logical register addresses in ascending order.
+     * @param values Filled with the values, widened to int64.
+     * @return The generation the values belong to.
+     */
+    uint64_t snapshot(std::vector<uint16_t>& addresses, std::vector<int64_t>& values) const;
+
+    /**
+     * @brief Runs the simulated clock at speed times real time from now on (1 = real time).
+     */
+    void setClockSpeed(double speed);
 
 private:
-    void run();
+    time_t simulatedTime() const;
+    void adoptPublishedConfig();
     void updateSimulationState();
     double calculatePowerOutput();
     double calculateGridVoltage(int phase);
     double calculateGridFrequency();
 
     std::shared_ptr<SafeDataModel> data_model;
-    const Config& config;
-    std::thread simulation_thread;
-    std::atomic<bool> running;
+    std::shared_ptr<const Config> config;           // Used by the simulation thread only
+    std::shared_ptr<const Config> published_config; // Accessed with std::atomic_load/atomic_store
+    size_t device_index;
+    const DeviceConfig* device;           // Points into config
+    const SimulationParams* sim_params;   // Points into device->device_template
+    std::mutex command_mutex;
+    std::vector<std::function<void()>> commands; // Guarded by command_mutex
+    std::function<void(SimulationEngine*)> command_notifier;
+    std::vector<std::function<void(uint64_t)>> tick_listeners;
 
     // Simulation state variables
     enum class DeviceState { OFF, OK, WARNING, ERROR };
@@ -32,6 +146,14 @@ private:
     int current_weather_model_index;
     time_t last_weather_change_time;
     int last_daily_reset_day;
+    int connection_timer;
+    double prev_temp;
+    uint64_t last_generation;
+
+    // Simulated clock: sim_origin at real_origin, advancing clock_speed seconds per real second
+    time_t sim_origin;
+    std::chrono::steady_clock::time_point real_origin;
+    double clock_speed;
     
     // Random number generation
     std::mt19937 rng;
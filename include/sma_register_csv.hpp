@@ -0,0 +1,103 @@
+#ifndef SMA_REGISTER_CSV_H
+#define SMA_REGISTER_CSV_H
+
+#include "digital_twin.hpp"
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @class CsvReader
+ * @brief Streaming CSV parser that reuses one line buffer for every row.
+ *
+ * Quoted fields (including doubled quotes and embedded line breaks) are
+ * unescaped in place, and fields are returned as views into the buffer, so
+ * parsing a row allocates nothing once the buffer has grown to the longest
+ * line. The delimiter (',' ';' or tab) is detected from the first line
+ * unless given explicitly.
+ */
+class CsvReader {
+public:
+    /**
+     * @param in The stream to read from.
+     * @param delimiter Field delimiter, or 0 to detect it from the first line.
+     */
+    explicit CsvReader(std::istream& in, char delimiter = 0);
+
+    /**
+     * @brief Reads the next non-empty row.
+     * @param fields Filled with views that stay valid until the next call.
+     * @return False at end of input.
+     */
+    bool next(std::vector<std::string_view>& fields);
+
+    /**
+     * @brief Line number of the last row returned (1-based).
+     */
+    size_t lineNumber() const { return line_number; }
+
+private:
+    std::istream& in;
+    char delimiter;
+    std::string line;
+    std::string continuation;
+    std::vector<std::pair<size_t, size_t>> spans; // Field offset and length within line
+    size_t line_number;
+};
+
+/**
+ * @struct SmaRegisterEntry
+ * @brief One register imported from an SMA register list.
+ */
+struct SmaRegisterEntry {
+    Register reg;
+    std::string description; ///< Only filled when text is requested
+    std::string unit;        ///< Only filled when text is requested
+};
+
+/**
+ * @struct SmaImportStats
+ * @brief What happened to the rows of an imported register list.
+ */
+struct SmaImportStats {
+    size_t rows = 0;
+    size_t imported = 0;
+    size_t unsupported_type = 0; ///< e.g. STR32 text registers
+    size_t duplicates = 0;       ///< Rows overlapping an earlier register
+    size_t unknown_format = 0;   ///< Imported with RAW format
+};
+
+/**
+ * @class SmaRegisterCsv
+ * @brief Reads the register lists SMA publishes for its Modbus devices.
+ *
+ * Columns are located by header name (address, type, format, access, unit,
+ * description; matching is case-insensitive and tolerant of the wording used
+ * in different list revisions). Rows with types the simulator cannot
+ * represent are skipped, and rows that overlap a register already imported
+ * are dropped, so the result always passes ConfigLoader::validateRegisters().
+ */
+class SmaRegisterCsv {
+public:
+    /**
+     * @brief Parses a register list.
+     * @param in The CSV stream.
+     * @param entries Receives the imported registers in ascending address order.
+     * @param stats Receives row counts.
+     * @param error Set when the header lacks a required column.
+     * @param with_text Also keep description and unit (for profile generation).
+     * @return False if the list could not be interpreted.
+     */
+    static bool read(std::istream& in, std::vector<SmaRegisterEntry>& entries, SmaImportStats& stats,
+                     std::string& error, bool with_text = false);
+
+    /**
+     * @brief Convenience wrapper that opens a file and returns bare registers.
+     * @throw std::runtime_error if the file cannot be opened or interpreted.
+     */
+    static std::vector<Register> load(const std::string& filename, SmaImportStats& stats);
+};
+
+#endif // SMA_REGISTER_CSV_H
@@ -0,0 +1,79 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class SpscQueue
+ * @brief Bounded lock-free single-producer/single-consumer ring of preallocated slots.
+ *
+ * The producer fills a slot in place (beginPush/commitPush) and the consumer
+ * reads it in place (front/pop), so slots holding buffers are reused without
+ * allocating on either side.
+ */
+template<typename T>
+class SpscQueue {
+public:
+    /**
+     * @param capacity Number of slots; rounded up to a power of two.
+     * @param prototype Value every slot is initialized with (e.g. a pre-sized buffer).
+     */
+    explicit SpscQueue(size_t capacity, const T& prototype = T()) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots.assign(size, prototype);
+        mask = size - 1;
+    }
+
+    /**
+     * @brief Producer: gets the next free slot, or nullptr if the queue is full.
+     */
+    T* beginPush() {
+        size_t tail = tail_index.load(std::memory_order_relaxed);
+        if (tail - head_index.load(std::memory_order_acquire) > mask) {
+            return nullptr;
+        }
+        return &slots[tail & mask];
+    }
+
+    /**
+     * @brief Producer: publishes the slot returned by beginPush().
+     */
+    void commitPush() {
+        tail_index.store(tail_index.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Consumer: gets the oldest filled slot, or nullptr if the queue is empty.
+     */
+    T* front() {
+        size_t head = head_index.load(std::memory_order_relaxed);
+        if (head == tail_index.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[head & mask];
+    }
+
+    /**
+     * @brief Consumer: releases the slot returned by front().
+     */
+    void pop() {
+        head_index.store(head_index.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool empty() const {
+        return head_index.load(std::memory_order_acquire) == tail_index.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head_index{0};
+    alignas(64) std::atomic<size_t> tail_index{0};
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,77 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @class TimerWheel
+ * @brief Hashed timing wheel for large numbers of short, coarse-grained deadlines.
+ *
+ * Deadlines are rounded up to ticks of a fixed resolution and hashed into
+ * slot_count slots, so scheduling is O(1) regardless of how many entries are
+ * pending, and advancing costs one slot per elapsed tick. Deadlines further
+ * away than one revolution wait in their slot until their tick comes round.
+ * Callbacks never run early, and entries of the same tick run in the order
+ * they were scheduled. Not thread-safe: schedule and advance from one thread
+ * (typically an EventLoop timer that calls advance() every tick).
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void()>;
+
+    /**
+     * @param resolution Length of one tick.
+     * @param slot_count Number of slots; one revolution spans resolution * slot_count.
+     */
+    TimerWheel(Clock::duration resolution, size_t slot_count);
+
+    /**
+     * @brief Schedules a callback; deadlines in the past run on the next tick.
+     */
+    void schedule(Clock::time_point deadline, Callback callback);
+
+    /**
+     * @brief Runs every callback whose tick has been reached by now.
+     * @return The number of callbacks run.
+     * @note Callbacks may schedule new entries.
+     */
+    size_t advance(Clock::time_point now);
+
+    /**
+     * @brief Gets the start of the next tick, when advance() next has work to check.
+     */
+    Clock::time_point nextTick() const;
+
+    /**
+     * @brief Gets the time from which the earliest pending entry can run, or Clock::time_point::max() if none.
+     * @note Scans at most one revolution of slots, and every entry only if none is due within it.
+     */
+    Clock::time_point nextDeadline() const;
+
+    size_t size() const {
+        return pending;
+    }
+
+    bool empty() const {
+        return pending == 0;
+    }
+
+private:
+    struct Entry {
+        uint64_t tick;
+        Callback callback;
+    };
+
+    Clock::duration resolution;
+    Clock::time_point origin;
+    uint64_t current_tick;
+    size_t pending;
+    std::vector<std::vector<Entry>> slots;
+};
+
+#endif // TIMER_WHEEL_H
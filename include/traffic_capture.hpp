@@ -0,0 +1,58 @@
+#ifndef TRAFFIC_CAPTURE_H
+#define TRAFFIC_CAPTURE_H
+
+#include "traffic_capture_format.hpp"
+#include <mutex>
+#include <string>
+
+/**
+ * @class TrafficCapture
+ * @brief Records every Modbus request and response frame into a memory-mapped ring file.
+ *
+ * Frames are copied straight into the mapping, so capturing costs one memcpy
+ * per frame and never allocates. When the ring is full the oldest records
+ * are overwritten. tools/modbus_replay.cpp reads the file back.
+ */
+class TrafficCapture {
+public:
+    TrafficCapture();
+
+    /**
+     * @brief Destructor, syncs and unmaps the capture file.
+     */
+    ~TrafficCapture();
+
+    /**
+     * @brief Creates (or truncates) and maps the capture file.
+     * @param filename Path of the capture file.
+     * @param capacity_bytes Size of the ring space.
+     * @return True on success, false on failure.
+     */
+    bool open(const std::string& filename, size_t capacity_bytes);
+
+    /**
+     * @brief Appends one frame.
+     * @param connection_id Identifies the client connection the frame belongs to.
+     * @param direction Whether the frame is a request or a response.
+     * @param frame The raw ADU bytes.
+     * @param length Number of bytes in frame.
+     */
+    void record(uint32_t connection_id, capture::Direction direction, const uint8_t* frame, size_t length);
+
+    /**
+     * @brief Flushes the mapping to disk and unmaps it.
+     */
+    void close();
+
+    bool isOpen() const {
+        return header != nullptr;
+    }
+
+private:
+    std::mutex capture_mutex;
+    capture::CaptureFileHeader* header;
+    uint8_t* ring;
+    size_t mapping_size;
+};
+
+#endif // TRAFFIC_CAPTURE_H
@@ -0,0 +1,56 @@
+#ifndef TRAFFIC_CAPTURE_FORMAT_H
+#define TRAFFIC_CAPTURE_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Layout of the memory-mapped Modbus capture ring written by TrafficCapture.
+ *
+ * The file starts with a CaptureFileHeader followed by `capacity` bytes of
+ * ring space. Records are 8-byte aligned and never split: when a record does
+ * not fit before the end of the ring, the writer wraps to offset 0 (leaving a
+ * CaptureRecordHeader with direction PADDING if there is room for one).
+ * `head` and `tail` are monotonic byte offsets; the retained records are
+ * those in [tail, head), taken modulo capacity.
+ */
+namespace capture {
+
+    constexpr uint32_t FILE_MAGIC = 0x43414D53; // "SMAC"
+    constexpr uint32_t FORMAT_VERSION = 1;
+
+    enum class Direction : uint8_t {
+        Request = 0,
+        Response = 1,
+        Padding = 0xFF
+    };
+
+    struct CaptureFileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t capacity;      // Bytes of ring space after this header
+        uint64_t head;          // Monotonic offset one past the newest record
+        uint64_t tail;          // Monotonic offset of the oldest retained record
+        uint64_t record_count;  // Records written since the capture started
+        uint64_t dropped_count; // Records overwritten by wrap-around
+    };
+
+    struct CaptureRecordHeader {
+        uint32_t record_size;   // Total size including this header and padding
+        uint32_t connection_id;
+        int64_t timestamp_ns;   // CLOCK_REALTIME
+        uint8_t direction;      // Direction
+        uint8_t reserved;
+        uint16_t frame_length;  // Bytes of the raw ADU that follow
+        uint32_t reserved2;
+    };
+
+    static_assert(sizeof(CaptureRecordHeader) == 24, "capture record header must stay packed");
+
+    inline uint32_t recordSize(size_t frame_length) {
+        return static_cast<uint32_t>((sizeof(CaptureRecordHeader) + frame_length + 7) & ~size_t{7});
+    }
+
+} // namespace capture
+
+#endif // TRAFFIC_CAPTURE_FORMAT_H
@@ -0,0 +1,86 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include "numa_topology.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WorkStealingPool
+ * @brief Fixed set of threads that run batches of indexed tasks, balancing load by stealing.
+ *
+ * parallelFor() splits the index range into one contiguous block per thread,
+ * so neighbouring tasks (and the memory they touch) stay on one core. A
+ * thread takes tasks from the front of its own queue and, once it runs dry,
+ * steals from the back of the others'. The calling thread works as one of the
+ * pool's threads, so a pool of size 1 starts no threads at all. The workers
+ * can be confined to a set of CPUs, e.g. the CPUs of one NUMA node, and given
+ * a real-time scheduling policy.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * @param thread_count Threads working on a batch, the caller included; 0 uses every core.
+     * @param placement CPUs and scheduling policy of the worker threads; the default leaves them as they are.
+     */
+    explicit WorkStealingPool(size_t thread_count, ThreadPlacement placement = {});
+
+    /**
+     * @brief Destructor, joins the worker threads.
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief Runs task(i) for every i in [0, count) and returns once all have finished.
+     * @note Call from one thread at a time; tasks must not call parallelFor().
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+    size_t threadCount() const {
+        return queues.size();
+    }
+
+    /// Tasks run by a thread other than the one they were assigned to.
+    uint64_t steals() const {
+        return steal_count.load(std::memory_order_relaxed);
+    }
+
+    /// The pool's worker threads (excluding the caller), e.g. for setting their affinity.
+    std::vector<std::thread>& threads() {
+        return workers;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    void workerLoop(size_t self);
+    bool runOne(size_t self);
+
+    std::vector<std::unique_ptr<Queue>> queues; // One per thread; 0 belongs to the caller
+    std::vector<std::thread> workers;
+    ThreadPlacement worker_placement;
+    std::mutex batch_mutex;
+    std::condition_variable batch_ready;
+    std::condition_variable batch_done;
+    const std::function<void(size_t)>* task; // Set for the duration of parallelFor()
+    uint64_t batch;                          // Guarded by batch_mutex; bumped per parallelFor()
+    bool stopping;                           // Guarded by batch_mutex
+    std::atomic<size_t> remaining;
+    std::atomic<uint64_t> steal_count;
+};
+
+#endif // WORK_STEALING_POOL_H
@@ -0,0 +1,433 @@
+#include "admin_server.hpp"
+#include "log_level.hpp"
+#include <iostream>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    constexpr size_t READ_CHUNK = 4096;
+    // A client sending a longer line is disconnected
+    constexpr size_t MAX_LINE_LENGTH = 1024;
+
+    const char* const HELP_TEXT =
+        "devices                          list devices: index, unit ID, serial number, template\n"
+        "status [<device>|all]            state, weather, power, temperature, tick and simulated time\n"
+        "weather <device>|all <name>      force a weather model (held for weather_change_interval_seconds)\n"
+        "fault <device>|all on|off        inject or clear a fault\n"
+        "speed <factor> [<device>|all]    run the simulated clock at factor x real time\n"
+        "snapshot <device>                every register value as of the last tick\n"
+        "metrics                          tick scheduler and Modbus server counters\n"
+        "log error|warning|info|debug     verbosity of runtime event messages\n";
+
+    const char* const LOG_LEVEL_NAMES[] = {"error", "warning", "info", "debug"};
+
+    std::vector<std::string> splitWords(const std::string& line) {
+        std::vector<std::string> words;
+        std::istringstream stream(line);
+        std::string word;
+        while (stream >> word) {
+            words.push_back(word);
+        }
+        return words;
+    }
+}
+
+AdminServer::AdminServer(EventLoop& event_loop, std::vector<SimulationEngine*> device_engines,
+                         const FleetScheduler* fleet_scheduler, std::vector<ModbusServer*> modbus)
+    : loop(event_loop), engines(std::move(device_engines)), scheduler(fleet_scheduler), modbus_servers(std::move(modbus)),
+      listen_fd(-1), client_count(0) {}
+
+AdminServer::~AdminServer() {
+    stop();
+}
+
+bool AdminServer::start(const std::string& path) {
+    socket_path = path;
+    if (socket_path.size() >= sizeof(sockaddr_un::sun_path)) {
+        std::cerr << "Admin socket path too long: " << socket_path << std::endl;
+        return false;
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        std::cerr << "Failed to create admin socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 || listen(listen_fd, 16) == -1 ||
+        !loop.addFd(listen_fd, EPOLLIN, [this](uint32_t) { onAccept(); })) {
+        std::cerr << "Unable to listen on admin socket " << socket_path << ": " << strerror(errno) << std::endl;
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void AdminServer::stop() {
+    if (listen_fd == -1) return;
+    while (!clients.empty()) {
+        closeClient(*clients.begin()->second);
+    }
+    loop.removeFd(listen_fd);
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(socket_path.c_str());
+}
+
+void AdminServer::onAccept() {
+    int fd;
+    while ((fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        auto client = std::make_unique<Client>();
+        client->fd = fd;
+        client->id = ++client_count;
+        client->events = EPOLLIN;
+        Client* c = client.get();
+        clients[fd] = std::move(client);
+        if (!loop.addFd(fd, EPOLLIN, [this, c](uint32_t events) { onClientEvent(*c, events); })) {
+            closeClient(*c);
+        }
+    }
+}
+
+void AdminServer::onClientEvent(Client& client, uint32_t events) {
+    if (events & EPOLLOUT) {
+        if (!flush(client)) {
+            closeClient(client);
+            return;
+        }
+        if (client.tx.empty()) {
+            processNext(client);
+            return;
+        }
+    }
+    if (!(events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+        return;
+    }
+
+    char buffer[READ_CHUNK];
+    ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return;
+        }
+        closeClient(client);
+        return;
+    }
+    client.rx.append(buffer, static_cast<size_t>(n));
+    if (client.rx.find('\n') == std::string::npos && client.rx.size() > MAX_LINE_LENGTH) {
+        closeClient(client);
+        return;
+    }
+    processNext(client);
+}
+
+void AdminServer::processNext(Client& client) {
+    size_t end;
+    // The next request waits until the previous reply has been sent, and nothing more is read meanwhile, so a
+    // client that does not read stalls itself only and cannot grow rx
+    while (!client.busy && client.tx.empty() && (end = client.rx.find('\n')) != std::string::npos) {
+        std::vector<std::string> args = splitWords(client.rx.substr(0, end));
+        client.rx.erase(0, end + 1);
+        if (args.empty()) {
+            continue;
+        }
+        client.busy = true;
+        int fd = client.fd;
+        uint32_t id = client.id;
+        // The reply may come from this thread or a shard scheduler thread; either way it is handled on the next round
+        execute(args, [this, fd, id](std::string reply) {
+            loop.post([this, fd, id, reply = std::move(reply)]() mutable { complete(fd, id, std::move(reply)); });
+        });
+    }
+    updateInterest(client);
+}
+
+void AdminServer::complete(int fd, uint32_t id, std::string reply) {
+    auto it = clients.find(fd);
+    if (it == clients.end() || it->second->id != id) {
+        return; // The client is gone
+    }
+    Client& client = *it->second;
+    client.busy = false;
+    client.tx += reply;
+    if (!flush(client)) {
+        closeClient(client);
+        return;
+    }
+    processNext(client);
+}
+
+bool AdminServer::flush(Client& client) {
+    size_t sent = 0;
+    while (sent < client.tx.size()) {
+        ssize_t n = send(client.fd, client.tx.data() + sent, client.tx.size() - sent, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    client.tx.erase(0, sent);
+    return true;
+}
+
+void AdminServer::updateInterest(Client& client) {
+    // Read only while idle; hangups and errors are reported either way
+    uint32_t events = 0;
+    if (!client.tx.empty()) {
+        events = EPOLLOUT;
+    } else if (!client.busy) {
+        events = EPOLLIN;
+    }
+    if (events != client.events && loop.modifyFd(client.fd, events)) {
+        client.events = events;
+    }
+}
+
+void AdminServer::closeClient(Client& client) {
+    int fd = client.fd;
+    loop.removeFd(fd);
+    close(fd);
+    clients.erase(fd); // Destroys client
+}
+
+void AdminServer::execute(const std::vector<std::string>& args, ReplyHandler done) {
+    const std::string& command = args[0];
+    std::vector<size_t> indices;
+    std::string error;
+
+    if (command == "help") {
+        done(std::string(HELP_TEXT) + "OK\n");
+    } else if (command == "devices" || command == "status") {
+        if (!selectEngines(args.size() > 1 ? args[1] : "all", indices, error)) {
+            done("ERR " + error + "\n");
+            return;
+        }
+        bool full = command == "status";
+        runOnEngines(std::move(indices), [full](size_t index, SimulationEngine& engine, std::string& output) {
+            SimulationEngine::Status status = engine.status();
+            std::ostringstream line;
+            line << index << " unit=" << status.device->identity.unit_id
+                 << " serial=" << status.device->identity.serial_number
+                 << " template=" << status.device->device_template->name;
+            if (full) {
+                line << " state=" << status.state << " weather=\"" << status.weather << "\""
+                     << " power_w=" << static_cast<int64_t>(status.ac_power_watts)
+                     << " temp_c=" << std::round(status.internal_temp_celsius * 10) / 10
+                     << " generation=" << status.generation << " time=" << status.simulated_time
+                     << " speed=" << status.clock_speed;
+            }
+            output += line.str() + "\n";
+            return true;
+        }, std::move(done));
+    } else if (command == "weather" && args.size() >= 3) {
+        if (!selectEngines(args[1], indices, error)) {
+            done("ERR " + error + "\n");
+            return;
+        }
+        // Weather names may contain spaces ("Partly Cloudy")
+        std::string name = args[2];
+        for (size_t i = 3; i < args.size(); ++i) {
+            name += " " + args[i];
+        }
+        runOnEngines(std::move(indices), [name](size_t index, SimulationEngine& engine, std::string& output) {
+            if (!engine.forceWeather(name)) {
+                output += std::to_string(index) + " has no weather model \"" + name + "\"\n";
+                return false;
+            }
+            return true;
+        }, std::move(done));
+    } else if (command == "fault" && args.size() == 3 && (args[2] == "on" || args[2] == "off")) {
+        if (!selectEngines(args[1], indices, error)) {
+            done("ERR " + error + "\n");
+            return;
+        }
+        bool fault = args[2] == "on";
+        runOnEngines(std::move(indices), [fault](size_t, SimulationEngine& engine, std::string&) {
+            engine.forceFault(fault);
+            return true;
+        }, std::move(done));
+    } else if (command == "speed" && (args.size() == 2 || args.size() == 3)) {
+        double speed;
+        try {
+            speed = std::stod(args[1]);
+        } catch (const std::exception&) {
+            speed = -1;
+        }
+        if (!(speed >= 0)) {
+            done("ERR invalid speed " + args[1] + "\n");
+            return;
+        }
+        if (!selectEngines(args.size() > 2 ? args[2] : "all", indices, error)) {
+            done("ERR " + error + "\n");
+            return;
+        }
+        runOnEngines(std::move(indices), [speed](size_t, SimulationEngine& engine, std::string&) {
+            engine.setClockSpeed(speed);
+            return true;
+        }, std::move(done));
+    } else if (command == "snapshot" && args.size() == 2) {
+        if (!selectEngines(args[1], indices, error) || indices.size() != 1) {
+            done("ERR " + (error.empty() ? "snapshot takes a single device" : error) + "\n");
+            return;
+        }
+        runOnEngines(std::move(indices), [](size_t, SimulationEngine& engine, std::string& output) {
+            std::vector<uint16_t> addresses;
+            std::vector<int64_t> values;
+            uint64_t generation = engine.snapshot(addresses, values);
+            output += "generation " + std::to_string(generation) + "\n";
+            for (size_t i = 0; i < addresses.size(); ++i) {
+                output += std::to_string(addresses[i]) + " " + std::to_string(values[i]) + "\n";
+            }
+            return true;
+        }, std::move(done));
+    } else if (command == "metrics" && args.size() == 1) {
+        replyMetrics(std::move(done));
+    } else if (command == "log" && args.size() <= 2) {
+        if (args.size() == 2) {
+            size_t level = 0;
+            while (level < 4 && args[1] != LOG_LEVEL_NAMES[level]) {
+                ++level;
+            }
+            if (level == 4) {
+                done("ERR unknown log level " + args[1] + "\n");
+                return;
+            }
+            g_log_level.store(static_cast<LogLevel>(level), std::memory_order_relaxed);
+        }
+        done(std::string("level ") + LOG_LEVEL_NAMES[static_cast<size_t>(g_log_level.load())] + "\nOK\n");
+    } else {
+        done("ERR unknown command or wrong arguments, see help\n");
+    }
+}
+
+bool AdminServer::selectEngines(const std::string& selector, std::vector<size_t>& indices, std::string& error) const {
+    indices.clear();
+    if (selector == "all") {
+        for (size_t i = 0; i < engines.size(); ++i) {
+            indices.push_back(i);
+        }
+        return true;
+    }
+    char* end = nullptr;
+    unsigned long index = std::strtoul(selector.c_str(), &end, 10);
+    if (selector.empty() || *end != '\0' || index >= engines.size()) {
+        error = "no device " + selector + " (0-" + std::to_string(engines.size() - 1) + " or all)";
+        return false;
+    }
+    indices.push_back(index);
+    return true;
+}
+
+void AdminServer::runOnEngines(std::vector<size_t> indices, EngineCommand command, ReplyHandler done) {
+    // Each device runs its part on its shard's scheduler thread between rounds; the last one to finish posts
+    // the reply to the loop
+    struct Gather {
+        std::vector<std::string> outputs;
+        std::atomic<size_t> remaining;
+        std::atomic<bool> failed{false};
+        EngineCommand command;
+        ReplyHandler done;
+    };
+    auto gather = std::make_shared<Gather>();
+    gather->outputs.resize(indices.size());
+    gather->remaining = indices.size();
+    gather->command = std::move(command);
+    gather->done = std::move(done);
+
+    for (size_t slot = 0; slot < indices.size(); ++slot) {
+        size_t index = indices[slot];
+        SimulationEngine* engine = engines[index];
+        engine->post([gather, slot, index, engine] {
+            if (!gather->command(index, *engine, gather->outputs[slot])) {
+                gather->failed = true;
+            }
+            if (gather->remaining.fetch_sub(1) == 1) {
+                std::string reply;
+                for (const auto& output : gather->outputs) {
+                    reply += output;
+                }
+                reply += gather->failed ? "ERR command failed on some devices\n" : "OK\n";
+                gather->done(std::move(reply));
+            }
+        });
+    }
+}
+
+void AdminServer::replyMetrics(ReplyHandler done) {
+    FleetScheduler::Metrics ticks = scheduler->metrics();
+    std::ostringstream fleet;
+    fleet << "devices " << engines.size() << "\n"
+          << "scheduler_shards " << ticks.shards << "\n"
+          << "scheduler_threads " << ticks.threads << "\n"
+          << "scheduler_rounds " << ticks.rounds << "\n"
+          << "scheduler_ticks " << ticks.ticks << "\n"
+          << "scheduler_steals " << ticks.steals << "\n"
+          << "scheduler_last_round_ms " << ticks.last_round_ms << "\n"
+          << "scheduler_max_round_ms " << ticks.max_round_ms << "\n"
+          << "scheduler_max_lateness_ms " << ticks.max_lateness_ms << "\n"
+          << "scheduler_lateness_p50_ms " << ticks.lateness_p50_ms << "\n"
+          << "scheduler_lateness_p99_ms " << ticks.lateness_p99_ms << "\n"
+          << "modbus_servers " << modbus_servers.size() << "\n";
+    if (modbus_servers.empty()) {
+        done(fleet.str() + "OK\n");
+        return;
+    }
+
+    // Each server reports on its own loop thread; the last one to report sends the sum
+    struct Gather {
+        std::mutex mutex;
+        ModbusServer::Metrics sum{};
+        size_t remaining;
+        std::string prefix;
+        ReplyHandler done;
+    };
+    auto gather = std::make_shared<Gather>();
+    gather->remaining = modbus_servers.size();
+    gather->prefix = fleet.str();
+    gather->done = std::move(done);
+    for (ModbusServer* server : modbus_servers) {
+        server->queryMetrics([gather](const ModbusServer::Metrics& metrics) {
+            std::unique_lock<std::mutex> lock(gather->mutex);
+            ModbusServer::Metrics& sum = gather->sum;
+            sum.requests += metrics.requests;
+            sum.shed += metrics.shed;
+            sum.lost += metrics.lost;
+            sum.disconnects += metrics.disconnects;
+            sum.slow_clients += metrics.slow_clients;
+            sum.connections += metrics.connections;
+            sum.open_connections += metrics.open_connections;
+            sum.parked_responses += metrics.parked_responses;
+            sum.output_blocks += metrics.output_blocks;
+            if (--gather->remaining > 0) return;
+            lock.unlock();
+
+            std::ostringstream reply;
+            reply << gather->prefix << "modbus_requests " << sum.requests << "\n"
+                  << "modbus_shed " << sum.shed << "\n"
+                  << "modbus_lost " << sum.lost << "\n"
+                  << "modbus_model_disconnects " << sum.disconnects << "\n"
+                  << "modbus_slow_clients " << sum.slow_clients << "\n"
+                  << "modbus_connections_total " << sum.connections << "\n"
+                  << "modbus_connections_open " << sum.open_connections << "\n"
+                  << "modbus_parked_responses " << sum.parked_responses << "\n"
+                  << "modbus_output_blocks " << sum.output_blocks << "\n"
+                  << "OK\n";
+            gather->done(reply.str());
+        });
+    }
+}
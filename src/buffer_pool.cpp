@@ -0,0 +1,26 @@
+#include "buffer_pool.hpp"
+#include <algorithm>
+
+BufferPool::BufferPool(size_t block_size, size_t blocks_per_slab)
+    : block_size(block_size), blocks_per_slab(std::max<size_t>(blocks_per_slab, 1)), in_use(0) {}
+
+uint8_t* BufferPool::acquire() {
+    if (free_blocks.empty()) {
+        slabs.push_back(std::make_unique<uint8_t[]>(block_size * blocks_per_slab));
+        uint8_t* slab = slabs.back().get();
+        free_blocks.reserve(free_blocks.size() + blocks_per_slab);
+        // Pushed in reverse so blocks are handed out in address order
+        for (size_t i = blocks_per_slab; i-- > 0;) {
+            free_blocks.push_back(slab + i * block_size);
+        }
+    }
+    uint8_t* block = free_blocks.back();
+    free_blocks.pop_back();
+    ++in_use;
+    return block;
+}
+
+void BufferPool::release(uint8_t* block) {
+    free_blocks.push_back(block);
+    --in_use;
+}
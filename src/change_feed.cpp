@@ -0,0 +1,266 @@
+#include "change_feed.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    // Clients that fall this far behind are disconnected rather than buffered
+    constexpr size_t MAX_CLIENT_BACKLOG_BYTES = 1 << 20;
+}
+
+ChangeFeed::ChangeFeed(std::shared_ptr<SafeDataModel> model)
+    : data_model(model), next_subscriber_id(1), published_generation(0), listen_fd(-1), wake_pipe{-1, -1},
+      running(false) {}
+
+ChangeFeed::~ChangeFeed() {
+    stop();
+}
+
+int ChangeFeed::subscribe(Subscriber subscriber) {
+    std::lock_guard<std::mutex> lock(subscriber_mutex);
+    int id = next_subscriber_id++;
+    subscribers.emplace_back(id, std::move(subscriber));
+    return id;
+}
+
+void ChangeFeed::unsubscribe(int id) {
+    std::lock_guard<std::mutex> lock(subscriber_mutex);
+    subscribers.erase(
+        std::remove_if(subscribers.begin(), subscribers.end(), [id](const auto& s) { return s.first == id; }),
+        subscribers.end());
+}
+
+bool ChangeFeed::start(const std::string& path) {
+    if (running) return true;
+    socket_path = path;
+
+    if (socket_path.size() >= sizeof(sockaddr_un::sun_path)) {
+        std::cerr << "Change feed socket path too long: " << socket_path << std::endl;
+        return false;
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        std::cerr << "Failed to create change feed socket: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 || listen(listen_fd, 16) == -1) {
+        std::cerr << "Unable to listen on change feed socket " << socket_path << ": " << strerror(errno) << std::endl;
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    if (pipe2(wake_pipe, O_NONBLOCK | O_CLOEXEC) == -1) {
+        std::cerr << "Failed to create change feed wake pipe: " << strerror(errno) << std::endl;
+        close(listen_fd);
+        listen_fd = -1;
+        unlink(socket_path.c_str());
+        return false;
+    }
+
+    running = true;
+    feed_thread = std::thread(&ChangeFeed::run, this);
+    return true;
+}
+
+void ChangeFeed::stop() {
+    if (!running) return;
+    running = false;
+
+    char byte = 0;
+    (void)!write(wake_pipe[1], &byte, 1);
+    if (feed_thread.joinable()) {
+        feed_thread.join();
+    }
+
+    for (auto& client : clients) {
+        close(client.fd);
+    }
+    clients.clear();
+    close(listen_fd);
+    listen_fd = -1;
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    wake_pipe[0] = wake_pipe[1] = -1;
+    unlink(socket_path.c_str());
+}
+
+void ChangeFeed::onTick(uint64_t generation) {
+    std::vector<RegisterDelta> changes;
+    if (!data_model->getTickChanges(generation, changes)) {
+        // Another tick was committed in between; socket clients catch up via changesSince()
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(subscriber_mutex);
+        if (!changes.empty()) {
+            for (auto& subscriber : subscribers) {
+                subscriber.second(generation, changes);
+            }
+        }
+    }
+
+    if (running) {
+        {
+            std::lock_guard<std::mutex> lock(tick_mutex);
+            published_generation = generation;
+            published_changes = std::move(changes);
+        }
+        char byte = 0;
+        (void)!write(wake_pipe[1], &byte, 1);
+    }
+}
+
+void ChangeFeed::run() {
+    std::cout << "Change feed thread started." << std::endl;
+    std::vector<pollfd> fds;
+    std::vector<RegisterDelta> tick_changes;
+    std::vector<RegisterDelta> catch_up;
+
+    while (running) {
+        fds.clear();
+        fds.push_back({wake_pipe[0], POLLIN, 0});
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (const auto& client : clients) {
+            fds.push_back({client.fd, static_cast<short>(POLLIN | (client.outbox.empty() ? 0 : POLLOUT)), 0});
+        }
+
+        if (poll(fds.data(), fds.size(), -1) == -1) {
+            if (errno == EINTR) continue;
+            std::cerr << "Change feed poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (!running) break;
+
+        // Handle existing clients first; indices in fds line up with clients
+        std::vector<bool> dead(clients.size(), false);
+        for (size_t i = 0; i < clients.size(); ++i) {
+            short revents = fds[i + 2].revents;
+            if (revents & (POLLERR | POLLHUP)) {
+                dead[i] = true;
+            } else if ((revents & POLLIN) && !readSubscription(clients[i])) {
+                dead[i] = true;
+            } else if ((revents & POLLOUT) && !flushClient(clients[i])) {
+                dead[i] = true;
+            }
+        }
+
+        // A new tick was published: stream it to every subscribed client
+        if (fds[0].revents & POLLIN) {
+            char drain[64];
+            while (read(wake_pipe[0], drain, sizeof(drain)) > 0) {
+            }
+
+            uint64_t generation;
+            {
+                std::lock_guard<std::mutex> lock(tick_mutex);
+                generation = published_generation;
+                tick_changes = published_changes;
+            }
+
+            for (size_t i = 0; i < clients.size(); ++i) {
+                Client& client = clients[i];
+                if (dead[i] || !client.subscribed || !client.outbox.empty() || client.generation >= generation) {
+                    continue;
+                }
+                if (client.generation + 1 == generation) {
+                    sendChanges(client, generation, tick_changes, false);
+                } else {
+                    uint64_t current = data_model->changesSince(client.generation, catch_up);
+                    sendChanges(client, current, catch_up, false);
+                }
+                if (!flushClient(client)) {
+                    dead[i] = true;
+                }
+            }
+        }
+
+        for (size_t i = clients.size(); i-- > 0;) {
+            if (dead[i]) {
+                close(clients[i].fd);
+                clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            acceptClients();
+        }
+    }
+    std::cout << "Change feed thread stopped." << std::endl;
+}
+
+void ChangeFeed::acceptClients() {
+    while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "Change feed accept failed: " << strerror(errno) << std::endl;
+            }
+            return;
+        }
+        clients.push_back({fd, false, 0, {}, {}});
+    }
+}
+
+bool ChangeFeed::readSubscription(Client& client) {
+    uint8_t buffer[64];
+    ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+    if (n == 0) return false;
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    if (client.subscribed) return true; // Anything after the subscription request is ignored
+
+    client.inbox.insert(client.inbox.end(), buffer, buffer + n);
+    if (client.inbox.size() < sizeof(uint64_t)) return true;
+
+    uint64_t since;
+    std::memcpy(&since, client.inbox.data(), sizeof(since));
+    client.inbox.clear();
+    client.subscribed = true;
+
+    // The catch-up frame is always sent so the client learns the current generation
+    std::vector<RegisterDelta> changes;
+    uint64_t current = data_model->changesSince(since, changes);
+    sendChanges(client, current, changes, true);
+    return flushClient(client);
+}
+
+void ChangeFeed::sendChanges(
+    Client& client,
+    uint64_t generation,
+    const std::vector<RegisterDelta>& changes,
+    bool always) {
+    client.generation = generation;
+    if (changes.empty() && !always) return;
+
+    ChangeFeedFrameHeader header{ChangeFeedFrameHeader::MAGIC, static_cast<uint32_t>(changes.size()), generation};
+    const uint8_t* header_bytes = reinterpret_cast<const uint8_t*>(&header);
+    const uint8_t* change_bytes = reinterpret_cast<const uint8_t*>(changes.data());
+    client.outbox.insert(client.outbox.end(), header_bytes, header_bytes + sizeof(header));
+    client.outbox.insert(client.outbox.end(), change_bytes, change_bytes + changes.size() * sizeof(RegisterDelta));
+}
+
+bool ChangeFeed::flushClient(Client& client) {
+    while (!client.outbox.empty()) {
+        ssize_t n = send(client.fd, client.outbox.data(), client.outbox.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        client.outbox.erase(client.outbox.begin(), client.outbox.begin() + n);
+    }
+    return client.outbox.size() <= MAX_CLIENT_BACKLOG_BYTES;
+}
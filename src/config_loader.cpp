@@ -1,7 +1,13 @@
 #include "config_loader.hpp"
+#include "register_schema.hpp"
+#include "sma_register_csv.hpp"
+#include "numa_topology.hpp"
 #include <yaml-cpp/yaml.h>
 #include <iostream>
 #include <stdexcept>
+#include <unordered_map>
+#include <algorithm>
+#include <arpa/inet.h>
 
 // Helper to convert string to enum
 RegisterAccess to_access(const std::string& s) {
@@ -36,82 +42,579 @@ RegisterFormat to_format(const std::string& s) {
     throw std::runtime_error("Invalid register format: " + s);
 }
 
+namespace {
+    // Overrides only the keys present in node, so templates and fleet entries can be partial
+    void parseSimulationParams(const YAML::Node& node, SimulationParams& params) {
+        params.update_interval_ms = node["update_interval_ms"].as<int>(params.update_interval_ms);
+        params.max_power_watts = node["max_power_watts"].as<double>(params.max_power_watts);
+        params.efficiency_percent = node["efficiency_percent"].as<double>(params.efficiency_percent);
+        params.max_internal_temp_celsius = node["max_internal_temp_celsius"].as<double>(params.max_internal_temp_celsius);
+        params.fault_probability_percent = node["fault_probability_percent"].as<double>(params.fault_probability_percent);
+        params.weather_change_interval_seconds =
+            node["weather_change_interval_seconds"].as<int>(params.weather_change_interval_seconds);
+        params.voltage_variation_percent = node["voltage_variation_percent"].as<double>(params.voltage_variation_percent);
+        params.grid_voltage_nominal = node["grid_voltage_nominal"].as<double>(params.grid_voltage_nominal);
+        params.grid_frequency_nominal = node["grid_frequency_nominal"].as<double>(params.grid_frequency_nominal);
+        params.frequency_variation_hz = node["frequency_variation_hz"].as<double>(params.frequency_variation_hz);
+        params.daily_yield_reset_hour = node["daily_yield_reset_hour"].as<int>(params.daily_yield_reset_hour);
+        params.ambient_temp_celsius = node["ambient_temp_celsius"].as<double>(params.ambient_temp_celsius);
+        params.startup_delay_seconds = node["startup_delay_seconds"].as<int>(params.startup_delay_seconds);
+        params.shutdown_delay_seconds = node["shutdown_delay_seconds"].as<int>(params.shutdown_delay_seconds);
+    }
+
+    // Overrides only the keys present in node, like parseSimulationParams
+    void parseResponseModel(const YAML::Node& node, ResponseModelParams& params) {
+        if (const auto& distribution = node["distribution"]) {
+            std::string name = distribution.as<std::string>();
+            if (name == "fixed") {
+                params.distribution = LatencyDistribution::Fixed;
+            } else if (name == "uniform") {
+                params.distribution = LatencyDistribution::Uniform;
+            } else if (name == "normal") {
+                params.distribution = LatencyDistribution::Normal;
+            } else if (name == "lognormal") {
+                params.distribution = LatencyDistribution::LogNormal;
+            } else {
+                throw std::runtime_error("Unknown latency distribution: " + name);
+            }
+        }
+        params.latency_ms = node["latency_ms"].as<double>(params.latency_ms);
+        params.jitter_ms = node["jitter_ms"].as<double>(params.jitter_ms);
+        params.min_latency_ms = node["min_latency_ms"].as<double>(params.min_latency_ms);
+        params.max_latency_ms = node["max_latency_ms"].as<double>(params.max_latency_ms);
+        params.loss_percent = node["loss_percent"].as<double>(params.loss_percent);
+        params.disconnect_percent = node["disconnect_percent"].as<double>(params.disconnect_percent);
+        if (params.latency_ms < 0 || params.jitter_ms < 0 || params.min_latency_ms < 0 ||
+            params.min_latency_ms > params.max_latency_ms || params.loss_percent < 0 ||
+            params.disconnect_percent < 0 || params.loss_percent + params.disconnect_percent > 100) {
+            throw std::runtime_error("Invalid response_model");
+        }
+    }
+
+    void parseWeatherModels(const YAML::Node& nodes, std::vector<WeatherModel>& models) {
+        models.clear();
+        for (const auto& node : nodes) {
+            models.push_back({
+                node["name"].as<std::string>(),
+                node["power_multiplier"].as<double>(),
+                node["temp_increase_factor"].as<double>()
+            });
+        }
+    }
+
+    void parseIdentity(const YAML::Node& node, DeviceIdentity& identity) {
+        identity.unit_id = node["unit_id"].as<int>(identity.unit_id);
+        identity.serial_number = node["serial_number"].as<uint32_t>(identity.serial_number);
+        identity.susy_id = node["susy_id"].as<uint32_t>(identity.susy_id);
+        identity.device_class = node["device_class"].as<uint32_t>(identity.device_class);
+        identity.manufacturer = node["manufacturer"].as<uint32_t>(identity.manufacturer);
+        identity.software_package = node["software_package"].as<uint32_t>(identity.software_package);
+    }
+
+    // Appends the YAML register entries; an entry for an address already present replaces it
+    void parseRegisters(const YAML::Node& reg_nodes, std::vector<Register>& registers) {
+        std::unordered_map<uint16_t, size_t> existing;
+        existing.reserve(registers.size());
+        for (size_t i = 0; i < registers.size(); ++i) {
+            existing[registers[i].address] = i;
+        }
+        registers.reserve(registers.size() + reg_nodes.size());
+        for (const auto& node : reg_nodes) {
+            Register reg;
+            reg.address = node["address"].as<uint16_t>();
+            reg.type = to_type(node["type"].as<std::string>());
+            reg.format = to_format(node["format"].as<std::string>());
+            reg.access = to_access(node["access"].as<std::string>());
+
+            // Initialize value based on type - make sure the variant type matches RegisterType
+            switch (reg.type) {
+                case RegisterType::U16:
+                    reg.value = node["value"] ? node["value"].as<uint16_t>() : static_cast<uint16_t>(0);
+                    reg.num_regs = 1;
+                    break;
+                case RegisterType::S16:
+                    reg.value = node["value"] ? node["value"].as<int16_t>() : static_cast<int16_t>(0);
+                    reg.num_regs = 1;
+                    break;
+                case RegisterType::U32:
+                    reg.value = node["value"] ? node["value"].as<uint32_t>() : static_cast<uint32_t>(0);
+                    reg.num_regs = 2;
+                    break;
+                case RegisterType::S32:
+                    reg.value = node["value"] ? node["value"].as<int32_t>() : static_cast<int32_t>(0);
+                    reg.num_regs = 2;
+                    break;
+                case RegisterType::U64:
+                    reg.value = node["value"] ? node["value"].as<uint64_t>() : static_cast<uint64_t>(0);
+                    reg.num_regs = 4;
+                    break;
+                case RegisterType::S64:
+                    reg.value = node["value"] ? node["value"].as<int64_t>() : static_cast<int64_t>(0);
+                    reg.num_regs = 4;
+                    break;
+            }
+            auto it = existing.find(reg.address);
+            if (it != existing.end()) {
+                registers[it->second] = reg;
+            } else {
+                registers.push_back(reg);
+            }
+        }
+    }
+
+    // A template's registers come from an imported SMA register list, YAML entries, or both
+    std::shared_ptr<const std::vector<Register>> loadRegisters(const YAML::Node& node, const std::string& profile_dir) {
+        const auto& csv_node = node["register_csv"];
+        const auto& reg_nodes = node["registers"];
+        if (!csv_node && !reg_nodes) {
+            return nullptr;
+        }
+
+        auto registers = std::make_shared<std::vector<Register>>();
+        if (csv_node) {
+            std::string path = csv_node.as<std::string>();
+            if (!path.empty() && path[0] != '/') {
+                path = profile_dir + "/" + path;
+            }
+            SmaImportStats stats;
+            *registers = SmaRegisterCsv::load(path, stats);
+            std::cout << "Imported " << stats.imported << " registers from " << path << " (" << stats.unsupported_type
+                      << " unsupported types, " << stats.duplicates << " overlapping rows skipped)" << std::endl;
+        }
+        if (reg_nodes) {
+            parseRegisters(reg_nodes, *registers);
+        }
+        ConfigLoader::validateRegisters(*registers);
+        return registers;
+    }
+
+    void validateTemplate(const DeviceTemplate& tpl) {
+        const std::string where = "device template '" + tpl.name + "'";
+        if (!tpl.registers || tpl.registers->empty()) {
+            throw std::runtime_error(where + " has no registers");
+        }
+        if (tpl.sim_params.update_interval_ms <= 0) {
+            throw std::runtime_error(where + ": update_interval_ms must be positive");
+        }
+        if (tpl.sim_params.weather_models.empty()) {
+            throw std::runtime_error(where + " has no weather models");
+        }
+    }
+
+    ModbusListenerParams parseListener(const YAML::Node& node) {
+        ModbusListenerParams listener;
+        std::string transport = node["transport"].as<std::string>("tcp");
+        if (transport == "tcp") {
+            listener.transport = ModbusTransport::TCP;
+        } else if (transport == "udp") {
+            listener.transport = ModbusTransport::UDP;
+        } else if (transport == "unix") {
+            listener.transport = ModbusTransport::UNIX;
+        } else {
+            throw std::runtime_error("Unknown Modbus transport: " + transport);
+        }
+        listener.address = node["address"].as<std::string>(listener.address);
+        listener.port = node["port"].as<int>(listener.port);
+        listener.socket_path = node["path"].as<std::string>("");
+        if (listener.transport == ModbusTransport::UNIX ? listener.socket_path.empty()
+                                                        : (listener.port <= 0 || listener.port > 65535)) {
+            throw std::runtime_error("Invalid Modbus " + transport + " listener");
+        }
+        return listener;
+    }
+
+    bool sameRegisterLayout(const std::vector<Register>& a, const std::vector<Register>& b, std::string& reason) {
+        if (a.size() != b.size()) {
+            reason = "register list changed";
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); ++i) {
+            if (a[i].address != b[i].address || a[i].type != b[i].type || a[i].access != b[i].access) {
+                reason = "register " + std::to_string(b[i].address) + " changed";
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
 Config ConfigLoader::loadConfig(const std::string& filename) {
     Config config;
     YAML::Node root = YAML::LoadFile(filename);
 
-    // Load Device Identity
-    const auto& identity_node = root["device_identity"];
-    config.identity.unit_id = identity_node["unit_id"].as<int>();
-    config.identity.serial_number = identity_node["serial_number"].as<uint32_t>();
-    config.identity.susy_id = identity_node["susy_id"].as<uint32_t>();
-    config.identity.device_class = identity_node["device_class"].as<uint32_t>();
-    config.identity.manufacturer = identity_node["manufacturer"].as<uint32_t>();
-    config.identity.software_package = identity_node["software_package"].as<uint32_t>();
-
-    // Load Simulation Parameters
-    const auto& sim_node = root["simulation_parameters"];
-    config.sim_params.update_interval_ms = sim_node["update_interval_ms"].as<int>();
-    config.sim_params.max_power_watts = sim_node["max_power_watts"].as<double>();
-    config.sim_params.efficiency_percent = sim_node["efficiency_percent"].as<double>();
-    config.sim_params.max_internal_temp_celsius = sim_node["max_internal_temp_celsius"].as<double>();
-    config.sim_params.fault_probability_percent = sim_node["fault_probability_percent"].as<double>();
-    config.sim_params.weather_change_interval_seconds = sim_node["weather_change_interval_seconds"].as<int>();
-    config.sim_params.voltage_variation_percent = sim_node["voltage_variation_percent"].as<double>();
-    config.sim_params.grid_voltage_nominal = sim_node["grid_voltage_nominal"].as<double>();
-    config.sim_params.grid_frequency_nominal = sim_node["grid_frequency_nominal"].as<double>();
-    config.sim_params.frequency_variation_hz = sim_node["frequency_variation_hz"].as<double>();
-    config.sim_params.daily_yield_reset_hour = sim_node["daily_yield_reset_hour"].as<int>();
-    config.sim_params.ambient_temp_celsius = sim_node["ambient_temp_celsius"].as<double>();
-    config.sim_params.startup_delay_seconds = sim_node["startup_delay_seconds"].as<int>();
-    config.sim_params.shutdown_delay_seconds = sim_node["shutdown_delay_seconds"].as<int>();
-
-    const auto& weather_nodes = root["weather_models"];
-    for (const auto& node : weather_nodes) {
-        config.sim_params.weather_models.push_back({
-            node["name"].as<std::string>(),
-            node["power_multiplier"].as<double>(),
-            node["temp_increase_factor"].as<double>()
-        });
-    }
-
-    // Load Registers
-    const auto& reg_nodes = root["registers"];
-    for (const auto& node : reg_nodes) {
-        Register reg;
-        reg.address = node["address"].as<uint16_t>();
-        reg.type = to_type(node["type"].as<std::string>());
-        reg.format = to_format(node["format"].as<std::string>());
-        reg.access = to_access(node["access"].as<std::string>());
-
-        // Initialize value based on type - make sure the variant type matches RegisterType
-        switch (reg.type) {
-            case RegisterType::U16:
-                reg.value = node["value"] ? node["value"].as<uint16_t>() : static_cast<uint16_t>(0);
-                reg.num_regs = 1;
-                break;
-            case RegisterType::S16:
-                reg.value = node["value"] ? node["value"].as<int16_t>() : static_cast<int16_t>(0);
-                reg.num_regs = 1;
-                break;
-            case RegisterType::U32:
-                reg.value = node["value"] ? node["value"].as<uint32_t>() : static_cast<uint32_t>(0);
-                reg.num_regs = 2;
-                break;
-            case RegisterType::S32:
-                reg.value = node["value"] ? node["value"].as<int32_t>() : static_cast<int32_t>(0);
-                reg.num_regs = 2;
-                break;
-            case RegisterType::U64:
-                reg.value = node["value"] ? node["value"].as<uint64_t>() : static_cast<uint64_t>(0);
-                reg.num_regs = 4;
-                break;
-            case RegisterType::S64:
-                reg.value = node["value"] ? node["value"].as<int64_t>() : static_cast<int64_t>(0);
-                reg.num_regs = 4;
-                break;
-        }
-        config.registers.push_back(reg);
+    // Register lists referenced by the profile are resolved relative to it
+    auto slash = filename.find_last_of('/');
+    const std::string profile_dir = slash == std::string::npos ? "." : filename.substr(0, slash);
+
+    // The top-level identity, parameters, weather models and registers form the "default" template
+    DeviceIdentity base_identity{};
+    if (const auto& identity_node = root["device_identity"]) {
+        parseIdentity(identity_node, base_identity);
     }
+
+    auto default_template = std::make_shared<DeviceTemplate>();
+    default_template->name = "default";
+    default_template->sim_params = SimulationParams{};
+    if (const auto& sim_node = root["simulation_parameters"]) {
+        parseSimulationParams(sim_node, default_template->sim_params);
+    }
+    parseWeatherModels(root["weather_models"], default_template->sim_params.weather_models);
+    if (const auto& response_node = root["response_model"]) {
+        parseResponseModel(response_node, default_template->response_model);
+    }
+    if (auto registers = loadRegisters(root, profile_dir)) {
+        default_template->registers = registers;
+        default_template->schema = std::make_shared<const RegisterSchema>(*default_template->registers);
+    }
+
+    // Named templates inherit everything they do not override; the register list is parsed once per template
+    std::unordered_map<std::string, std::shared_ptr<const DeviceTemplate>> templates;
+    std::unordered_map<std::string, DeviceIdentity> template_identities;
+    templates["default"] = default_template;
+    template_identities["default"] = base_identity;
+    for (const auto& node : root["device_templates"]) {
+        auto tpl = std::make_shared<DeviceTemplate>(*default_template);
+        tpl->name = node["name"].as<std::string>();
+        if (const auto& sim_node = node["simulation_parameters"]) {
+            parseSimulationParams(sim_node, tpl->sim_params);
+        }
+        if (const auto& weather_nodes = node["weather_models"]) {
+            parseWeatherModels(weather_nodes, tpl->sim_params.weather_models);
+        }
+        if (const auto& response_node = node["response_model"]) {
+            parseResponseModel(response_node, tpl->response_model);
+        }
+        if (auto registers = loadRegisters(node, profile_dir)) {
+            tpl->registers = registers;
+            tpl->schema = std::make_shared<const RegisterSchema>(*tpl->registers);
+        }
+        validateTemplate(*tpl);
+
+        DeviceIdentity identity = base_identity;
+        if (const auto& identity_node = node["device_identity"]) {
+            parseIdentity(identity_node, identity);
+        }
+        template_identities[tpl->name] = identity;
+        templates[tpl->name] = tpl;
+    }
+
+    // Expand the fleet; without one, the profile describes a single device as before
+    if (const auto& fleet_node = root["fleet"]) {
+        for (const auto& entry : fleet_node) {
+            const std::string template_name = entry["template"].as<std::string>("default");
+            auto it = templates.find(template_name);
+            if (it == templates.end()) {
+                throw std::runtime_error("Fleet references unknown device template: " + template_name);
+            }
+            std::shared_ptr<const DeviceTemplate> tpl = it->second;
+            validateTemplate(*tpl);
+
+            // Parameter overrides get one derived template per entry, still sharing the register list
+            const auto& sim_node = entry["simulation_parameters"];
+            const auto& response_node = entry["response_model"];
+            if (sim_node || response_node) {
+                auto derived = std::make_shared<DeviceTemplate>(*tpl);
+                if (sim_node) {
+                    parseSimulationParams(sim_node, derived->sim_params);
+                }
+                if (response_node) {
+                    parseResponseModel(response_node, derived->response_model);
+                }
+                validateTemplate(*derived);
+                tpl = derived;
+            }
+
+            DeviceIdentity identity = template_identities[template_name];
+            parseIdentity(entry, identity);
+            const size_t count = entry["count"].as<size_t>(1);
+            const int unit_id_step = entry["unit_id_step"].as<int>(1);
+            const double max_power_watts = entry["max_power_watts"].as<double>(tpl->sim_params.max_power_watts);
+            const double azimuth_degrees = entry["azimuth_degrees"].as<double>(180.0);
+
+            config.devices.reserve(config.devices.size() + count);
+            for (size_t i = 0; i < count; ++i) {
+                DeviceConfig device{identity, max_power_watts, azimuth_degrees, tpl};
+                device.identity.unit_id = identity.unit_id + static_cast<int>(i) * unit_id_step;
+                device.identity.serial_number = identity.serial_number + static_cast<uint32_t>(i);
+                if (device.identity.unit_id < 1 || device.identity.unit_id > 247) {
+                    throw std::runtime_error("Fleet unit_id " + std::to_string(device.identity.unit_id) +
+                                             " is outside 1-247");
+                }
+                config.devices.push_back(device);
+            }
+        }
+    } else {
+        validateTemplate(*default_template);
+        config.devices.push_back(
+            {base_identity, default_template->sim_params.max_power_watts, 180.0, default_template});
+    }
+    if (config.devices.empty()) {
+        throw std::runtime_error("Profile defines no devices");
+    }
+
+    // Load optional shared-memory export settings
+    if (const auto& shm_node = root["shared_memory_export"]) {
+        config.shared_memory.enabled = shm_node["enabled"].as<bool>(false);
+        config.shared_memory.name = shm_node["name"].as<std::string>(config.shared_memory.name);
+    }
+
+    // Load optional change-feed settings
+    if (const auto& feed_node = root["change_feed"]) {
+        config.change_feed.enabled = feed_node["enabled"].as<bool>(false);
+        config.change_feed.socket_path = feed_node["socket_path"].as<std::string>(config.change_feed.socket_path);
+    }
+
+    if (const auto& admin_node = root["admin_socket"]) {
+        config.admin_socket.enabled = admin_node["enabled"].as<bool>(false);
+        config.admin_socket.socket_path = admin_node["socket_path"].as<std::string>(config.admin_socket.socket_path);
+    }
+
+    // Load optional register history settings
+    if (const auto& history_node = root["history"]) {
+        config.history.enabled = history_node["enabled"].as<bool>(false);
+        config.history.max_frames = history_node["max_frames"].as<size_t>(config.history.max_frames);
+        config.history.max_changes = history_node["max_changes"].as<size_t>(config.history.max_changes);
+        config.history.export_path = history_node["export_path"].as<std::string>(config.history.export_path);
+    }
+
+    // Load optional columnar time-series export settings
+    if (const auto& columnar_node = root["columnar_export"]) {
+        config.columnar_export.enabled = columnar_node["enabled"].as<bool>(false);
+        config.columnar_export.path = columnar_node["path"].as<std::string>(config.columnar_export.path);
+        config.columnar_export.rows_per_block =
+            columnar_node["rows_per_block"].as<size_t>(config.columnar_export.rows_per_block);
+        for (const auto& address : columnar_node["registers"]) {
+            config.columnar_export.registers.push_back(address.as<uint16_t>());
+        }
+    }
+
+    // Load optional Modbus traffic capture settings
+    if (const auto& capture_node = root["traffic_capture"]) {
+        config.traffic_capture.enabled = capture_node["enabled"].as<bool>(false);
+        config.traffic_capture.path = capture_node["path"].as<std::string>(config.traffic_capture.path);
+        config.traffic_capture.capacity_mb = capture_node["capacity_mb"].as<size_t>(config.traffic_capture.capacity_mb);
+    }
+
+    // Load the Modbus listeners; without the section the server keeps its classic TCP port
+    const YAML::Node server_node = root["modbus_server"];
+    for (const auto& listener_node : server_node["listeners"]) {
+        config.listeners.push_back(parseListener(listener_node));
+    }
+    if (const auto& per_device_node = server_node["port_per_device"]) {
+        PortPerDeviceParams& per_device = config.port_per_device;
+        per_device.enabled = per_device_node["enabled"].as<bool>(false);
+        per_device.base = parseListener(per_device_node);
+        per_device.per_address = per_device_node["per_address"].as<bool>(false);
+        if (per_device.enabled && per_device.base.transport != ModbusTransport::UNIX) {
+            // Every derived endpoint must be valid, so check the last one
+            size_t last = config.devices.size() - 1;
+            in_addr_t base_address = 0;
+            if (inet_pton(AF_INET, per_device.base.address.c_str(), &base_address) != 1) {
+                throw std::runtime_error("Invalid port_per_device address: " + per_device.base.address);
+            }
+            if (per_device.per_address ? ntohl(base_address) > 0xFFFFFFFEu - last
+                                       : per_device.base.port + last > 65535) {
+                throw std::runtime_error("port_per_device range too small for " +
+                                         std::to_string(config.devices.size()) + " devices");
+            }
+        }
+    }
+    if (const auto& limit_node = server_node["rate_limit"]) {
+        RateLimitParams& limit = config.rate_limit;
+        limit.enabled = limit_node["enabled"].as<bool>(false);
+        limit.connection_rate = limit_node["connection_rate"].as<double>(limit.connection_rate);
+        limit.connection_burst = limit_node["connection_burst"].as<double>(limit.connection_burst);
+        limit.source_rate = limit_node["source_rate"].as<double>(limit.source_rate);
+        limit.source_burst = limit_node["source_burst"].as<double>(limit.source_burst);
+        if (limit.connection_rate < 0 || limit.source_rate < 0 ||
+            (limit.connection_rate > 0 && limit.connection_burst < 1) || (limit.source_rate > 0 && limit.source_burst < 1)) {
+            throw std::runtime_error("rate_limit needs non-negative rates and bursts of at least 1");
+        }
+    }
+    if (config.listeners.empty() && !config.port_per_device.enabled) {
+        config.listeners.emplace_back();
+    }
+
+    // Load optional Modbus RTU buses
+    for (const auto& bus_node : root["rtu_buses"]) {
+        RtuBusParams bus;
+        bus.link_path = bus_node["link"].as<std::string>();
+        bus.baud_rate = bus_node["baud_rate"].as<int>(bus.baud_rate);
+        bus.parity = bus_node["parity"].as<std::string>(std::string(1, bus.parity)).c_str()[0];
+        bus.stop_bits = bus_node["stop_bits"].as<int>(bus.stop_bits);
+        for (const auto& unit : bus_node["unit_ids"]) {
+            bus.unit_ids.push_back(unit.as<int>());
+        }
+        if (bus.baud_rate <= 0 || (bus.parity != 'N' && bus.parity != 'E' && bus.parity != 'O') ||
+            (bus.stop_bits != 1 && bus.stop_bits != 2)) {
+            throw std::runtime_error("Invalid serial settings for RTU bus " + bus.link_path);
+        }
+        config.rtu_buses.push_back(bus);
+    }
+
+    if (const auto& scheduler_node = root["scheduler"]) {
+        config.scheduler.threads = scheduler_node["threads"].as<size_t>(config.scheduler.threads);
+        config.scheduler.numa_shards = scheduler_node["numa_shards"].as<bool>(config.scheduler.numa_shards);
+        if (const auto& phase = scheduler_node["phase"]) {
+            std::string name = phase.as<std::string>();
+            if (name == "aligned") {
+                config.scheduler.phase = TickPhase::Aligned;
+            } else if (name == "even") {
+                config.scheduler.phase = TickPhase::Even;
+            } else if (name == "random") {
+                config.scheduler.phase = TickPhase::Random;
+            } else {
+                throw std::runtime_error("Unknown scheduler phase: " + name);
+            }
+        }
+    }
+
+    // Load optional memory arena settings
+    if (const auto& arena_node = root["memory_arena"]) {
+        if (const auto& huge_pages = arena_node["huge_pages"]) {
+            std::string mode = huge_pages.as<std::string>();
+            if (mode == "off") {
+                config.memory_arena.huge_pages = HugePageMode::Off;
+            } else if (mode == "transparent") {
+                config.memory_arena.huge_pages = HugePageMode::Transparent;
+            } else if (mode == "explicit") {
+                config.memory_arena.huge_pages = HugePageMode::Explicit;
+            } else {
+                throw std::runtime_error("Unknown memory_arena huge_pages mode: " + mode);
+            }
+        }
+        config.memory_arena.chunk_mb = arena_node["chunk_mb"].as<size_t>(config.memory_arena.chunk_mb);
+        if (config.memory_arena.chunk_mb == 0) {
+            throw std::runtime_error("memory_arena chunk_mb must be positive");
+        }
+    }
+
+    // Load optional CPU affinity and real-time scheduling settings
+    if (const auto& realtime_node = root["realtime"]) {
+        auto parseCpus = [](const YAML::Node& node, const std::string& key) {
+            std::vector<int> cpus;
+            if (node) {
+                std::string list = node.as<std::string>();
+                cpus = NumaTopology::parseCpuList(list);
+                if (cpus.empty() && !list.empty()) {
+                    throw std::runtime_error("Invalid realtime " + key + ": " + list);
+                }
+            }
+            return cpus;
+        };
+        RealtimeParams& realtime = config.realtime;
+        realtime.tick_cpus = parseCpus(realtime_node["tick_cpus"], "tick_cpus");
+        realtime.server_cpus = parseCpus(realtime_node["server_cpus"], "server_cpus");
+        std::string policy = realtime_node["policy"].as<std::string>("other");
+        if (policy == "other") {
+            realtime.policy = SchedulingPolicy::Other;
+        } else if (policy == "fifo") {
+            realtime.policy = SchedulingPolicy::Fifo;
+        } else if (policy == "rr") {
+            realtime.policy = SchedulingPolicy::RoundRobin;
+        } else {
+            throw std::runtime_error("Unknown realtime policy: " + policy);
+        }
+        realtime.priority = realtime_node["priority"].as<int>(realtime.policy == SchedulingPolicy::Other ? 0 : 10);
+        if (realtime.policy != SchedulingPolicy::Other && (realtime.priority < 1 || realtime.priority > 99)) {
+            throw std::runtime_error("realtime priority must be between 1 and 99");
+        }
+        realtime.lock_memory = realtime_node["lock_memory"].as<bool>(realtime.lock_memory);
+    }
+
+    // Load optional hot-reload settings
+    if (const auto& reload_node = root["hot_reload"]) {
+        config.hot_reload.watch_file = reload_node["watch_file"].as<bool>(false);
+    }
+
     return config;
-}
\ No newline at end of file
+}
+
+void ConfigLoader::validateRegisters(const std::vector<Register>& registers) {
+    std::vector<const Register*> sorted;
+    sorted.reserve(registers.size());
+    for (const auto& reg : registers) {
+        sorted.push_back(&reg);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Register* a, const Register* b) {
+        return a->address < b->address;
+    });
+
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const Register& reg = *sorted[i];
+        uint32_t end = static_cast<uint32_t>(reg.address) + static_cast<uint32_t>(reg.num_regs);
+        if (end > 65536) {
+            throw std::runtime_error("Register " + std::to_string(reg.address) + " extends past address 65535");
+        }
+        if (i + 1 < sorted.size() && sorted[i + 1]->address < end) {
+            const Register& next = *sorted[i + 1];
+            throw std::runtime_error(next.address == reg.address
+                ? "Register " + std::to_string(reg.address) + " is defined twice"
+                : "Register " + std::to_string(next.address) + " overlaps register " + std::to_string(reg.address) +
+                  " (" + std::to_string(reg.num_regs) + " words)");
+        }
+    }
+}
+
+bool ConfigLoader::isReloadCompatible(const Config& current, const Config& candidate, std::string& reason) {
+    if (candidate.devices.size() != current.devices.size()) {
+        reason = "number of devices changed";
+        return false;
+    }
+    for (size_t i = 0; i < candidate.devices.size(); ++i) {
+        const DeviceConfig& a = current.devices[i];
+        const DeviceConfig& b = candidate.devices[i];
+        if (a.identity.unit_id != b.identity.unit_id || a.identity.serial_number != b.identity.serial_number) {
+            reason = "identity of device " + std::to_string(i) + " changed";
+            return false;
+        }
+        // Devices built from the same template share both schemas, so compare each pair once
+        if (i > 0 && a.device_template->registers == current.devices[i - 1].device_template->registers &&
+            b.device_template->registers == candidate.devices[i - 1].device_template->registers) {
+            continue;
+        }
+        if (!sameRegisterLayout(*a.device_template->registers, *b.device_template->registers, reason)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string ConfigLoader::expandDevicePath(const std::string& pattern, const DeviceIdentity& identity, bool unique) {
+    std::string path = pattern;
+    bool expanded = false;
+    auto substitute = [&](const std::string& key, const std::string& value) {
+        for (size_t pos; (pos = path.find(key)) != std::string::npos;) {
+            path.replace(pos, key.size(), value);
+            expanded = true;
+        }
+    };
+    substitute("{serial}", std::to_string(identity.serial_number));
+    substitute("{unit_id}", std::to_string(identity.unit_id));
+
+    if (unique && !expanded) {
+        // Insert the serial number before the extension of the last path component
+        size_t slash = path.find_last_of('/');
+        size_t dot = path.find_last_of('.');
+        size_t insert_at = (dot != std::string::npos && (slash == std::string::npos || dot > slash + 1)) ? dot : path.size();
+        path.insert(insert_at, "_" + std::to_string(identity.serial_number));
+    }
+    return path;
+}
+
+ModbusListenerParams ConfigLoader::deviceListener(const PortPerDeviceParams& params, size_t index,
+                                                  const DeviceIdentity& identity) {
+    ModbusListenerParams listener = params.base;
+    if (listener.transport == ModbusTransport::UNIX) {
+        listener.socket_path = expandDevicePath(listener.socket_path, identity, true);
+    } else if (params.per_address) {
+        in_addr addr{};
+        inet_pton(AF_INET, listener.address.c_str(), &addr);
+        addr.s_addr = htonl(ntohl(addr.s_addr) + static_cast<uint32_t>(index));
+        char text[INET_ADDRSTRLEN];
+        listener.address = inet_ntop(AF_INET, &addr, text, sizeof(text));
+    } else {
+        listener.port += static_cast<int>(index);
+    }
+    return listener;
+}
@@ -0,0 +1,144 @@
+#include "config_reloader.hpp"
+#include "config_loader.hpp"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+    // Editors often write a file in several steps; wait for them to settle before parsing
+    constexpr int SETTLE_MS = 200;
+
+    std::string directoryOf(const std::string& path) {
+        auto slash = path.find_last_of('/');
+        if (slash == std::string::npos) return ".";
+        if (slash == 0) return "/";
+        return path.substr(0, slash);
+    }
+
+    std::string baseNameOf(const std::string& path) {
+        auto slash = path.find_last_of('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+}
+
+ConfigReloader::ConfigReloader(const std::string& file, std::shared_ptr<const Config> cfg, ReloadCallback callback)
+    : filename(file), current(std::move(cfg)), on_reload(std::move(callback)), wake_fd(-1), inotify_fd(-1),
+      running(false) {}
+
+ConfigReloader::~ConfigReloader() {
+    stop();
+}
+
+bool ConfigReloader::start(bool watch_file) {
+    if (running) return true;
+
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd == -1) {
+        std::cerr << "Failed to create reload eventfd: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (watch_file) {
+        inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd == -1 ||
+            inotify_add_watch(inotify_fd, directoryOf(filename).c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+            std::cerr << "Failed to watch " << filename << " for changes: " << strerror(errno) << std::endl;
+            if (inotify_fd != -1) close(inotify_fd);
+            inotify_fd = -1;
+            close(wake_fd);
+            wake_fd = -1;
+            return false;
+        }
+    }
+
+    running = true;
+    reload_thread = std::thread(&ConfigReloader::run, this);
+    return true;
+}
+
+void ConfigReloader::stop() {
+    if (!running) return;
+    running = false;
+    requestReload();
+    if (reload_thread.joinable()) {
+        reload_thread.join();
+    }
+    if (inotify_fd != -1) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+    close(wake_fd);
+    wake_fd = -1;
+}
+
+void ConfigReloader::requestReload() {
+    uint64_t one = 1;
+    (void)!write(wake_fd, &one, sizeof(one));
+}
+
+void ConfigReloader::run() {
+    const std::string base_name = baseNameOf(filename);
+    alignas(inotify_event) char events[4096];
+
+    while (running) {
+        pollfd fds[2] = {{wake_fd, POLLIN, 0}, {inotify_fd, POLLIN, 0}};
+        int nfds = inotify_fd != -1 ? 2 : 1;
+        if (poll(fds, nfds, -1) == -1) {
+            if (errno == EINTR) continue;
+            std::cerr << "Config reload poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (!running) break;
+
+        bool triggered = false;
+        if (fds[0].revents & POLLIN) {
+            uint64_t count;
+            (void)!read(wake_fd, &count, sizeof(count));
+            triggered = true;
+        }
+
+        if (nfds == 2 && (fds[1].revents & POLLIN)) {
+            // Drain events until the directory has been quiet for SETTLE_MS
+            do {
+                ssize_t n;
+                while ((n = read(inotify_fd, events, sizeof(events))) > 0) {
+                    for (char* p = events; p < events + n;) {
+                        auto* event = reinterpret_cast<inotify_event*>(p);
+                        if (event->len > 0 && base_name == event->name) {
+                            triggered = true;
+                        }
+                        p += sizeof(inotify_event) + event->len;
+                    }
+                }
+            } while (running && poll(&fds[1], 1, SETTLE_MS) > 0);
+        }
+
+        if (triggered && running) {
+            reload();
+        }
+    }
+}
+
+void ConfigReloader::reload() {
+    std::shared_ptr<const Config> candidate;
+    try {
+        candidate = std::make_shared<const Config>(ConfigLoader::loadConfig(filename));
+    } catch (const std::exception& e) {
+        std::cerr << "Config reload rejected, " << filename << " could not be parsed: " << e.what() << std::endl;
+        return;
+    }
+
+    std::string reason;
+    if (!ConfigLoader::isReloadCompatible(*current, *candidate, reason)) {
+        std::cerr << "Config reload rejected: " << reason << " (restart required)" << std::endl;
+        return;
+    }
+
+    current = candidate;
+    on_reload(std::move(candidate));
+    std::cout << "Configuration reloaded from " << filename << "." << std::endl;
+}
@@ -0,0 +1,175 @@
+#include "event_loop.hpp"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace {
+    constexpr int MAX_EVENTS = 64;
+}
+
+EventLoop::EventLoop()
+    : epoll_fd(-1), timer_fd(-1), wake_fd(-1), running(false), next_timer_id(1),
+      armed_deadline(Clock::time_point::max()) {}
+
+EventLoop::~EventLoop() {
+    if (epoll_fd != -1) close(epoll_fd);
+    if (timer_fd != -1) close(timer_fd);
+    if (wake_fd != -1) close(wake_fd);
+}
+
+bool EventLoop::open() {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    // steady_clock is CLOCK_MONOTONIC, so timer deadlines can be passed to the timerfd as absolute times
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd == -1 || timer_fd == -1 || wake_fd == -1) {
+        std::cerr << "Failed to create event loop: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = timer_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, timer_fd, &ev);
+    ev.data.fd = wake_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+    running = true;
+    return true;
+}
+
+void EventLoop::run() {
+    epoll_event events[MAX_EVENTS];
+    while (running) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            std::cerr << "Event loop wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < n && running; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == timer_fd || fd == wake_fd) {
+                uint64_t count;
+                (void)!read(fd, &count, sizeof(count));
+                if (fd == wake_fd) {
+                    runPosted();
+                }
+                continue;
+            }
+            auto it = handlers.find(fd);
+            if (it != handlers.end()) {
+                std::shared_ptr<FdHandler> handler = it->second;
+                (*handler)(events[i].events);
+            }
+        }
+        runDueTimers();
+    }
+}
+
+void EventLoop::stop() {
+    running = false;
+    if (wake_fd != -1) {
+        uint64_t one = 1;
+        (void)!write(wake_fd, &one, sizeof(one));
+    }
+}
+
+void EventLoop::post(std::function<void()> callback) {
+    {
+        std::lock_guard<std::mutex> lock(posted_mutex);
+        posted.push_back(std::move(callback));
+    }
+    uint64_t one = 1;
+    (void)!write(wake_fd, &one, sizeof(one));
+}
+
+void EventLoop::runPosted() {
+    std::vector<std::function<void()>> batch;
+    {
+        std::lock_guard<std::mutex> lock(posted_mutex);
+        batch.swap(posted);
+    }
+    for (auto& callback : batch) {
+        callback();
+    }
+}
+
+bool EventLoop::addFd(int fd, uint32_t events, FdHandler handler) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        std::cerr << "Failed to watch descriptor " << fd << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    handlers[fd] = std::make_shared<FdHandler>(std::move(handler));
+    return true;
+}
+
+bool EventLoop::modifyFd(int fd, uint32_t events) {
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = fd;
+    return epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void EventLoop::removeFd(int fd) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    handlers.erase(fd);
+}
+
+EventLoop::TimerId EventLoop::addTimer(Clock::time_point deadline, std::function<void()> callback) {
+    TimerId id = next_timer_id++;
+    timers.push({deadline, id});
+    timer_callbacks.emplace(id, std::move(callback));
+    if (deadline < armed_deadline) {
+        armTimerFd();
+    }
+    return id;
+}
+
+void EventLoop::cancelTimer(TimerId id) {
+    // The heap entry stays until it reaches the top; without a callback it is simply dropped
+    timer_callbacks.erase(id);
+}
+
+void EventLoop::runDueTimers() {
+    Clock::time_point now = Clock::now();
+    while (!timers.empty() && timers.top().deadline <= now) {
+        TimerId id = timers.top().id;
+        timers.pop();
+        auto it = timer_callbacks.find(id);
+        if (it == timer_callbacks.end()) continue;
+        std::function<void()> callback = std::move(it->second);
+        timer_callbacks.erase(it);
+        callback();
+    }
+    if (armed_deadline <= now) {
+        armed_deadline = Clock::time_point::max(); // That arming has expired, so the next one must be set
+    }
+    armTimerFd();
+}
+
+void EventLoop::armTimerFd() {
+    while (!timers.empty() && timer_callbacks.find(timers.top().id) == timer_callbacks.end()) {
+        timers.pop();
+    }
+
+    Clock::time_point deadline = timers.empty() ? Clock::time_point::max() : timers.top().deadline;
+    if (deadline == armed_deadline) return;
+    armed_deadline = deadline;
+
+    itimerspec spec{};
+    if (!timers.empty()) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        if (ns <= 0) ns = 1; // A zero value would disarm the timer
+        spec.it_value.tv_sec = static_cast<time_t>(ns / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(ns % 1000000000);
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
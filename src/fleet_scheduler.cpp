@@ -0,0 +1,235 @@
+#include "fleet_scheduler.hpp"
+#include <iostream>
+#include <algorithm>
+#include <random>
+
+namespace {
+    // Devices per chunk: about 64 engines and their register words (a few KiB each) fit a core's L2 cache
+    constexpr size_t MAX_CHUNK_DEVICES = 64;
+    // Enough chunks per thread that stealing can even out uneven devices
+    constexpr size_t CHUNKS_PER_THREAD = 8;
+    // Rounds whose lateness the percentiles are computed over
+    constexpr size_t LATENESS_SAMPLES = 1024;
+    // Rounds this small run on the scheduler thread alone; waking the pool would cost more than the ticks
+    constexpr size_t SERIAL_ROUND_DEVICES = 8;
+    // Tick wheel: 1 ms resolution, one revolution covers update intervals up to about 4 s
+    constexpr auto WHEEL_RESOLUTION = std::chrono::milliseconds(1);
+    constexpr size_t WHEEL_SLOTS = 4096;
+
+    double milliseconds(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+FleetScheduler::FleetScheduler(std::vector<SimulationEngine*> fleet, const SchedulerParams& params,
+                               std::vector<FleetShard> ranges)
+    : engines(std::move(fleet)), phase(params.phase), started(false) {
+    const size_t threads = params.threads;
+    if (ranges.empty()) {
+        ranges.push_back(FleetShard{0, {}, 0, engines.size()});
+    }
+    size_t assigned = 0;
+    for (FleetShard& range : ranges) {
+        auto shard = std::make_unique<Shard>();
+        if (threads == 0) {
+            shard->thread_count = range.placement.cpus.empty() ? std::thread::hardware_concurrency()
+                                                               : range.placement.cpus.size();
+        } else {
+            // Cumulative rounding, so the shares add up to the configured total
+            size_t end = threads * (range.first + range.count) / std::max<size_t>(engines.size(), 1);
+            shard->thread_count = end - std::min(end, assigned);
+            assigned = end;
+        }
+        // More threads than devices would only ever steal
+        shard->thread_count = std::max<size_t>(1, std::min(shard->thread_count, range.count));
+        shard->range = std::move(range);
+
+        Shard* target_shard = shard.get();
+        for (size_t i = 0; i < shard->range.count; ++i) {
+            engines[shard->range.first + i]->setCommandNotifier([target_shard](SimulationEngine* target) {
+                {
+                    std::lock_guard<std::mutex> lock(target_shard->wake_mutex);
+                    target_shard->pending_commands.push_back(target);
+                }
+                target_shard->wake.notify_one();
+            });
+        }
+        shards.push_back(std::move(shard));
+    }
+}
+
+FleetScheduler::~FleetScheduler() {
+    stop();
+}
+
+void FleetScheduler::start() {
+    if (started) return;
+    started = true;
+    Clock::time_point now = Clock::now();
+    std::mt19937 random_engine(std::random_device{}());
+    for (auto& shard : shards) {
+        shard->pool = std::make_unique<WorkStealingPool>(shard->thread_count, shard->range.placement);
+        shard->wheel = std::make_unique<TimerWheel>(WHEEL_RESOLUTION, WHEEL_SLOTS);
+        shard->next_due.resize(shard->range.count);
+        shard->due.reserve(shard->range.count);
+        for (size_t i = 0; i < shard->range.count; ++i) {
+            // Offsets are spread over the whole fleet, not per shard, so shards interleave too
+            size_t device = shard->range.first + i;
+            std::chrono::microseconds interval(engines[device]->updateIntervalMs() * int64_t{1000});
+            std::chrono::microseconds offset(0);
+            if (phase == TickPhase::Even) {
+                offset = interval * static_cast<int64_t>(device) / static_cast<int64_t>(engines.size());
+            } else if (phase == TickPhase::Random) {
+                offset = std::chrono::microseconds(
+                    std::uniform_int_distribution<int64_t>(0, interval.count() - 1)(random_engine));
+            }
+            shard->next_due[i] = now + offset;
+            scheduleTick(*shard, i);
+        }
+        shard->stats.threads = shard->thread_count;
+        shard->running = true;
+        shard->scheduler_thread = std::thread(&FleetScheduler::run, this, std::ref(*shard));
+        if (shards.size() > 1) {
+            std::cout << "Fleet shard on NUMA node " << shard->range.node << ": devices " << shard->range.first
+                      << "-" << shard->range.first + shard->range.count - 1 << " on " << shard->thread_count
+                      << " thread(s)." << std::endl;
+        }
+    }
+    Metrics total = metrics();
+    std::cout << "Fleet scheduler: " << engines.size() << " device(s) on " << total.threads << " thread(s)." << std::endl;
+}
+
+void FleetScheduler::stop() {
+    if (!started) return;
+    started = false;
+    for (auto& shard : shards) {
+        {
+            std::lock_guard<std::mutex> lock(shard->wake_mutex);
+            shard->running = false;
+        }
+        shard->wake.notify_one();
+    }
+    for (auto& shard : shards) {
+        if (shard->scheduler_thread.joinable()) {
+            shard->scheduler_thread.join();
+        }
+        shard->pool.reset();
+    }
+    std::cout << "Fleet scheduler stopped." << std::endl;
+}
+
+FleetScheduler::Metrics FleetScheduler::metrics() const {
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    Metrics total{};
+    total.shards = shards.size();
+    std::vector<double> lateness;
+    for (const auto& shard : shards) {
+        lateness.insert(lateness.end(), shard->lateness_ms.begin(), shard->lateness_ms.end());
+        const Metrics& stats = shard->stats;
+        total.rounds += stats.rounds;
+        total.ticks += stats.ticks;
+        total.threads += stats.threads;
+        total.steals += shard->pool ? shard->pool->steals() : 0;
+        total.last_round_ms = std::max(total.last_round_ms, stats.last_round_ms);
+        total.max_round_ms = std::max(total.max_round_ms, stats.max_round_ms);
+        total.max_lateness_ms = std::max(total.max_lateness_ms, stats.max_lateness_ms);
+    }
+    auto percentile = [&lateness](size_t percent) {
+        auto nth = lateness.begin() + (lateness.size() - 1) * percent / 100;
+        std::nth_element(lateness.begin(), nth, lateness.end());
+        return *nth;
+    };
+    if (!lateness.empty()) {
+        total.lateness_p50_ms = percentile(50);
+        total.lateness_p99_ms = percentile(99);
+    }
+    return total;
+}
+
+void FleetScheduler::run(Shard& shard) {
+    // Placed before the first tick, so everything this thread allocates stays on the shard's node
+    NumaTopology::placeCurrentThread(shard.range.placement);
+    std::vector<SimulationEngine*> commands;
+    std::unique_lock<std::mutex> lock(shard.wake_mutex);
+    while (shard.running) {
+        Clock::time_point next = shard.wheel->nextDeadline();
+        shard.wake.wait_until(lock, next, [&shard] { return !shard.running || !shard.pending_commands.empty(); });
+        if (!shard.running) break;
+
+        // Commands run here, between rounds, so they never overlap a tick of their engine
+        commands.swap(shard.pending_commands);
+        lock.unlock();
+        for (SimulationEngine* engine : commands) {
+            engine->runCommands();
+        }
+        commands.clear();
+
+        Clock::time_point now = Clock::now();
+        if (now >= next) {
+            runRound(shard, now);
+        }
+        lock.lock();
+    }
+}
+
+void FleetScheduler::scheduleTick(Shard& shard, size_t index) {
+    shard.wheel->schedule(shard.next_due[index], [&shard, index] { shard.due.push_back(index); });
+}
+
+void FleetScheduler::runRound(Shard& shard, Clock::time_point now) {
+    std::vector<size_t>& due = shard.due;
+    SimulationEngine* const* fleet = engines.data() + shard.range.first;
+    due.clear();
+    shard.wheel->advance(now);
+    if (due.empty()) return;
+    Clock::time_point earliest = now;
+    for (size_t i : due) {
+        earliest = std::min(earliest, shard.next_due[i]);
+    }
+
+    size_t chunk = std::clamp<size_t>(due.size() / (shard.thread_count * CHUNKS_PER_THREAD), 1, MAX_CHUNK_DEVICES);
+    size_t chunks = (due.size() + chunk - 1) / chunk;
+    auto forEachChunk = [&](void (SimulationEngine::*step)()) {
+        if (due.size() <= SERIAL_ROUND_DEVICES) {
+            for (size_t i : due) {
+                (fleet[i]->*step)();
+            }
+            return;
+        }
+        shard.pool->parallelFor(chunks, [&](size_t c) {
+            size_t end = std::min(due.size(), (c + 1) * chunk);
+            for (size_t k = c * chunk; k < end; ++k) {
+                (fleet[due[k]]->*step)();
+            }
+        });
+    };
+    forEachChunk(&SimulationEngine::update);
+    // Barrier: every device of the round has its new state before any snapshot is published
+    forEachChunk(&SimulationEngine::publish);
+
+    for (size_t i : due) {
+        std::chrono::milliseconds interval(fleet[i]->updateIntervalMs());
+        shard.next_due[i] += interval;
+        if (shard.next_due[i] <= now) {
+            // Skip missed ticks, keeping the device's phase
+            shard.next_due[i] += interval * ((now - shard.next_due[i]) / interval + 1);
+        }
+        scheduleTick(shard, i);
+    }
+
+    Clock::time_point finished = Clock::now();
+    std::lock_guard<std::mutex> lock(metrics_mutex);
+    Metrics& stats = shard.stats;
+    ++stats.rounds;
+    stats.ticks += due.size();
+    stats.last_round_ms = milliseconds(finished - now);
+    stats.max_round_ms = std::max(stats.max_round_ms, stats.last_round_ms);
+    double lateness = milliseconds(now - earliest);
+    stats.max_lateness_ms = std::max(stats.max_lateness_ms, lateness);
+    if (shard.lateness_ms.size() < LATENESS_SAMPLES) {
+        shard.lateness_ms.push_back(lateness);
+    } else {
+        shard.lateness_ms[shard.lateness_next] = lateness;
+        shard.lateness_next = (shard.lateness_next + 1) % LATENESS_SAMPLES;
+    }
+}
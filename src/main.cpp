@@ -2,35 +2,232 @@
 #include "config_loader.hpp"
 #include "safe_data_model.hpp"
 #include "simulation_engine.hpp"
+#include "fleet_scheduler.hpp"
 #include "modbus_server.hpp"
+#include "modbus_rtu_server.hpp"
+#include "shared_memory_exporter.hpp"
+#include "change_feed.hpp"
+#include "register_history.hpp"
+#include "columnar_exporter.hpp"
+#include "config_reloader.hpp"
+#include "event_loop.hpp"
+#include "admin_server.hpp"
+#include "numa_topology.hpp"
+#include "memory_arena.hpp"
 #include <iostream>
 #include <csignal>
+#include <cstring>
+#include <cerrno>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <unistd.h>
 #include <memory>
-#include <chrono>
-#include <thread>
+#include <unordered_set>
+#include <vector>
 
-// Global pointers for signal handling
-std::unique_ptr<SimulationEngine> g_sim_engine_ptr;
-std::unique_ptr<ModbusServer> g_modbus_server_ptr;
-std::atomic<bool> g_running{true};
+/**
+ * @struct DeviceRuntime
+ * @brief The data model, engine and optional exporters of one simulated device.
+ */
+struct DeviceRuntime {
+    DeviceIdentity identity;
+    std::shared_ptr<SafeDataModel> data_model;
+    std::unique_ptr<SharedMemoryExporter> shm_exporter;
+    std::unique_ptr<ChangeFeed> change_feed;
+    std::unique_ptr<RegisterHistory> history;
+    std::unique_ptr<ColumnarExporter> columnar_exporter;
+    std::string history_export_path;
+    std::shared_ptr<SimulationEngine> engine; // Allocated from the device's memory arena
+};
+
+// Global state torn down by shutdown()
+std::vector<std::unique_ptr<MemoryArena>> g_arenas; // One per fleet shard; declared first so it is unmapped last
+std::vector<DeviceRuntime> g_devices;
+std::unique_ptr<FleetScheduler> g_scheduler; // Declared after g_devices so it is destroyed before the engines
+std::vector<std::unique_ptr<ModbusServer>> g_modbus_servers; // One per fleet shard in port-per-device mode
+std::unique_ptr<ModbusRtuServer> g_rtu_server_ptr;
+std::unique_ptr<ConfigReloader> g_config_reloader_ptr;
 
 /**
- * @brief Signal handler for graceful shutdown (e.g., on Ctrl+C).
- * @param signum The signal number received.
+ * @brief Exports every device's register history as CSV (on SIGUSR1).
  */
-void signal_handler(int signum) {
-    std::cout << "\nCaught signal " << signum << ". Shutting down gracefully..." << std::endl;
-    if (g_modbus_server_ptr) {
-        g_modbus_server_ptr->stop();
+void export_history() {
+    for (auto& device : g_devices) {
+        if (!device.history) continue;
+        auto range = device.history->retainedRange();
+        if (device.history->exportCsv(device.history_export_path)) {
+            std::cout << "Exported register history (generations " << range.first << "-" << range.second
+                      << ") to " << device.history_export_path << std::endl;
+        }
+    }
+}
+
+/**
+ * @brief Stops every server, engine and exporter; each one wakes its thread, so this takes milliseconds.
+ */
+void shutdown() {
+    for (auto& server : g_modbus_servers) {
+        server->stop();
+    }
+    if (g_rtu_server_ptr) {
+        g_rtu_server_ptr->stop();
     }
-    if (g_sim_engine_ptr) {
-        g_sim_engine_ptr->stop();
+    if (g_scheduler) {
+        g_scheduler->stop();
     }
+    for (auto& device : g_devices) {
+        if (device.change_feed) {
+            device.change_feed->stop();
+        }
+        if (device.columnar_exporter) {
+            device.columnar_exporter->stop();
+        }
+    }
+    if (g_config_reloader_ptr) {
+        g_config_reloader_ptr->stop();
+    }
+}
+
+/**
+ * @brief Creates the data model, engine and exporters of device i in g_devices[i].
+ * @param arena Holds the device's registers, data model and engine.
+ * @return False if an exporter could not be started.
+ */
+bool create_device(size_t i, const Config& config, const std::shared_ptr<const Config>& shared_config,
+                   MemoryArena* arena) {
+    const bool unique_paths = config.devices.size() > 1;
+    const DeviceConfig& device_config = config.devices[i];
+    DeviceRuntime& device = g_devices[i];
+    device.identity = device_config.identity;
+
+    // Initialize Shared Data Model
+    device.data_model = std::allocate_shared<SafeDataModel>(ArenaAllocator<SafeDataModel>(arena));
+    device.data_model->initialize(device_config.device_template->schema, arena);
 
-    g_running = false;
+    // Initialize Simulation Engine ---
+    device.engine =
+        std::allocate_shared<SimulationEngine>(ArenaAllocator<SimulationEngine>(arena), device.data_model, shared_config, i);
+
+    // Optionally publish the register image to shared memory after every tick
+    if (config.shared_memory.enabled) {
+        std::string name = ConfigLoader::expandDevicePath(config.shared_memory.name, device.identity, unique_paths);
+        device.shm_exporter = std::make_unique<SharedMemoryExporter>(device.data_model, device.identity);
+        if (!device.shm_exporter->open(name)) {
+            std::cerr << "Failed to open shared memory export." << std::endl;
+            return false;
+        }
+        SharedMemoryExporter* exporter = device.shm_exporter.get();
+        device.engine->addTickListener([exporter](uint64_t) { exporter->publish(); });
+        std::cout << "Register image exported to shared memory " << name << "." << std::endl;
+    }
+
+    // Optionally stream per-tick register changes to local subscribers
+    if (config.change_feed.enabled) {
+        std::string path = ConfigLoader::expandDevicePath(config.change_feed.socket_path, device.identity, unique_paths);
+        device.change_feed = std::make_unique<ChangeFeed>(device.data_model);
+        if (!device.change_feed->start(path)) {
+            std::cerr << "Failed to start change feed." << std::endl;
+            return false;
+        }
+        ChangeFeed* feed = device.change_feed.get();
+        device.engine->addTickListener([feed](uint64_t generation) { feed->onTick(generation); });
+        std::cout << "Change feed listening on " << path << "." << std::endl;
+    }
+
+    // Optionally keep a bounded, delta-encoded history of every register
+    if (config.history.enabled) {
+        device.history_export_path =
+            ConfigLoader::expandDevicePath(config.history.export_path, device.identity, unique_paths);
+        device.history = std::make_unique<RegisterHistory>(
+            device.data_model, config.history.max_frames, config.history.max_changes);
+        RegisterHistory* history = device.history.get();
+        device.engine->addTickListener([history](uint64_t generation) { history->record(generation); });
+        std::cout << "Register history enabled (" << config.history.max_frames
+                  << " ticks). Send SIGUSR1 to export to " << device.history_export_path << "." << std::endl;
+    }
+
+    // Optionally stream selected registers to a columnar time-series file
+    if (config.columnar_export.enabled) {
+        std::string path = ConfigLoader::expandDevicePath(config.columnar_export.path, device.identity, unique_paths);
+        device.columnar_exporter = std::make_unique<ColumnarExporter>(device.data_model, device_config);
+        if (!device.columnar_exporter->start(
+                path, config.columnar_export.registers, config.columnar_export.rows_per_block)) {
+            std::cerr << "Failed to start columnar export." << std::endl;
+            return false;
+        }
+        ColumnarExporter* exporter = device.columnar_exporter.get();
+        device.engine->addTickListener([exporter](uint64_t generation) { exporter->onTick(generation); });
+        std::cout << "Columnar export of " << config.columnar_export.registers.size() << " registers to "
+                  << path << "." << std::endl;
+    }
+    return true;
+}
+
+/**
+ * @brief Starts a Modbus server for the devices of one shard and adds it to g_modbus_servers.
+ * @param shared_listeners Whether this server also owns the configured listeners, which reach every device.
+ * @return False if a listener could not be bound or the server could not start.
+ */
+bool start_modbus_server(const Config& config, const FleetShard& shard, bool shared_listeners,
+                         const std::shared_ptr<TrafficCapture>& capture) {
+    auto server = std::make_unique<ModbusServer>(g_devices[shard.first].data_model, config.devices[shard.first]);
+    for (size_t i = 1; shared_listeners && i < g_devices.size() && !config.listeners.empty(); ++i) {
+        if (!server->addDevice(config.devices[i], g_devices[i].data_model)) {
+            std::cerr << "Unit ID " << g_devices[i].identity.unit_id << " is already in use; device "
+                      << g_devices[i].identity.serial_number << " is not reachable over Modbus." << std::endl;
+        }
+    }
+    if (capture) {
+        server->setTrafficCapture(capture);
+    }
+    if (config.rate_limit.enabled) {
+        server->setRateLimit(config.rate_limit);
+    }
+    for (size_t i = 0; shared_listeners && i < config.listeners.size(); ++i) {
+        if (!server->addListener(config.listeners[i])) {
+            return false;
+        }
+    }
+    if (config.port_per_device.enabled) {
+        const size_t last_device = shard.first + shard.count - 1;
+        for (size_t i = shard.first; i <= last_device; ++i) {
+            ModbusListenerParams listener =
+                ConfigLoader::deviceListener(config.port_per_device, i, g_devices[i].identity);
+            if (!server->addDeviceListener(listener, config.devices[i], g_devices[i].data_model)) {
+                return false;
+            }
+        }
+        const ModbusListenerParams first =
+            ConfigLoader::deviceListener(config.port_per_device, shard.first, g_devices[shard.first].identity);
+        const ModbusListenerParams last =
+            ConfigLoader::deviceListener(config.port_per_device, last_device, g_devices[last_device].identity);
+        auto endpoint = [](const ModbusListenerParams& l) {
+            return l.transport == ModbusTransport::UNIX ? l.socket_path : l.address + ":" + std::to_string(l.port);
+        };
+        std::cout << "Port-per-device: " << shard.count << " listeners from " << endpoint(first) << " to "
+                  << endpoint(last) << "." << std::endl;
+    }
+    if (!server->start()) {
+        std::cerr << "Failed to start Modbus server." << std::endl;
+        return false;
+    }
+    g_modbus_servers.push_back(std::move(server));
+    return true;
 }
 
 int main(int argc, char* argv[]) {
+    // Signals are blocked before any thread starts, so every thread inherits the mask and they are
+    // only ever delivered through the signalfd, on the main thread, outside signal-handler context
+    sigset_t handled_signals;
+    sigemptyset(&handled_signals);
+    for (int signum : {SIGINT, SIGTERM, SIGUSR1, SIGHUP}) {
+        sigaddset(&handled_signals, signum);
+    }
+    pthread_sigmask(SIG_BLOCK, &handled_signals, nullptr);
+
     // Load Configuration
     std::string config_file = "sma_inverter_profile.yaml";
     if (argc > 1) {
@@ -46,40 +243,232 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     std::cout << "Configuration loaded successfully." << std::endl;
-    std::cout << "Simulating device with Serial Number: " << config.identity.serial_number << std::endl;
+    if (config.devices.size() == 1) {
+        std::cout << "Simulating device with Serial Number: " << config.devices[0].identity.serial_number << std::endl;
+    } else {
+        std::cout << "Simulating a fleet of " << config.devices.size() << " devices." << std::endl;
+    }
 
-    // Initialize Shared Data Model
-    auto shared_data_model = std::make_shared<SafeDataModel>();
-    shared_data_model->initialize(config.registers);
-    std::cout << "Shared data model initialized." << std::endl;
+    // Lock every page, present and future, so a tick never waits for a page fault
+    const RealtimeParams& realtime = config.realtime;
+    if (realtime.lock_memory) {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+            std::cout << "Process memory locked." << std::endl;
+        } else {
+            std::cerr << "Failed to lock memory: " << strerror(errno) << " (raise RLIMIT_MEMLOCK, e.g. ulimit -l)."
+                      << std::endl;
+        }
+    }
+
+    // Report each distinct register schema once; fleets built from one template share it
+    std::unordered_set<const RegisterSchema*> reported_schemas;
+    for (const auto& device_config : config.devices) {
+        const DeviceTemplate& tpl = *device_config.device_template;
+        if (reported_schemas.insert(tpl.schema.get()).second) {
+            std::cout << "Template '" << tpl.name << "': " << tpl.schema->registers().size() << " registers, "
+                      << tpl.schema->wordCount() << " words in " << tpl.schema->spans().size()
+                      << " contiguous spans." << std::endl;
+        }
+    }
+
+    // Every engine shares the same immutable Config, and through it the parsed register schemas
+    auto shared_config = std::make_shared<const Config>(config);
+
+    // Optionally split the fleet into one shard per NUMA node; each shard's devices are created by a
+    // thread bound to that node in an arena of its own, so their registers and engine state are allocated
+    // in its local memory
+    std::vector<FleetShard> node_shards;
+    if (config.scheduler.numa_shards) {
+        node_shards = NumaTopology::partition(NumaTopology::detect(), config.devices.size());
+        std::cout << "NUMA sharding: " << node_shards.size() << " shard(s)." << std::endl;
+    } else {
+        node_shards.push_back(FleetShard{0, {}, 0, config.devices.size()});
+    }
+    g_devices.resize(config.devices.size());
+    for (const FleetShard& shard : node_shards) {
+        g_arenas.push_back(std::make_unique<MemoryArena>(config.memory_arena.huge_pages,
+                                                         config.memory_arena.chunk_mb * 1024 * 1024));
+        MemoryArena* arena = g_arenas.back().get();
+        bool created = true;
+        // Bound to the whole node, not the tick CPUs: exporter threads started here inherit the mask
+        NumaTopology::runOn(shard.placement, [&] {
+            for (size_t i = shard.first; i < shard.first + shard.count && created; ++i) {
+                created = create_device(i, config, shared_config, arena);
+            }
+        });
+        if (!created) {
+            return 1;
+        }
+    }
+    size_t arena_used = 0;
+    size_t arena_mapped = 0;
+    for (const auto& arena : g_arenas) {
+        arena_used += arena->bytesUsed();
+        arena_mapped += arena->bytesMapped();
+    }
+    std::cout << "Shared data model initialized (" << arena_used / 1024 << " KiB of device state in "
+              << arena_mapped / (1024 * 1024) << " MiB of arena mappings)." << std::endl;
+
+    // Tick and server threads run on the configured CPUs of their shard's node, with the configured policy
+    auto placed = [&realtime](std::vector<FleetShard> shards, const std::vector<int>& cpus) {
+        for (FleetShard& shard : shards) {
+            shard.placement = ThreadPlacement{
+                NumaTopology::restrictCpus(shard.placement.cpus, cpus), realtime.policy, realtime.priority};
+        }
+        return shards;
+    };
+    if (!realtime.tick_cpus.empty() || !realtime.server_cpus.empty() || realtime.policy != SchedulingPolicy::Other) {
+        std::cout << "Real-time placement: " << realtime.tick_cpus.size() << " tick CPU(s), "
+                  << realtime.server_cpus.size() << " server CPU(s) (0 = any), "
+                  << (realtime.policy == SchedulingPolicy::Fifo ? "SCHED_FIFO"
+                      : realtime.policy == SchedulingPolicy::RoundRobin ? "SCHED_RR" : "SCHED_OTHER")
+                  << " priority " << realtime.priority << "." << std::endl;
+    }
+
+    // Every device ticks on one shared pool instead of a thread per device
+    std::vector<SimulationEngine*> engines;
+    for (auto& device : g_devices) {
+        engines.push_back(device.engine.get());
+    }
+    g_scheduler = std::make_unique<FleetScheduler>(engines, config.scheduler, placed(node_shards, realtime.tick_cpus));
+    g_scheduler->start();
 
-    // Initialize and Start Simulation Engine ---
-    g_sim_engine_ptr = std::make_unique<SimulationEngine>(shared_data_model, config);
-    g_sim_engine_ptr->start();
-    std::cout << "Simulation engine started in a background thread." << std::endl;
+    // Reload simulation parameters at runtime on SIGHUP (and optionally on file change)
+    g_config_reloader_ptr = std::make_unique<ConfigReloader>(
+        config_file,
+        shared_config,
+        [](std::shared_ptr<const Config> new_config) {
+            for (auto& device : g_devices) {
+                device.engine->reloadConfig(new_config);
+            }
+        });
+    if (!g_config_reloader_ptr->start(config.hot_reload.watch_file)) {
+        std::cerr << "Profile hot reload unavailable." << std::endl;
+        g_config_reloader_ptr.reset();
+    }
 
     // Initialize and Start Modbus Server ---
-    const int modbus_port = 1502; // Use a non-privileged port
-    g_modbus_server_ptr = std::make_unique<ModbusServer>(shared_data_model, config.identity.unit_id);
-    if (!g_modbus_server_ptr->start(modbus_port)) {
-        std::cerr << "Failed to start Modbus server." << std::endl;
-        g_sim_engine_ptr->stop();
+    auto stop_engines = []() {
+        g_scheduler->stop();
+    };
+    std::shared_ptr<TrafficCapture> capture;
+    if (config.traffic_capture.enabled) {
+        capture = std::make_shared<TrafficCapture>();
+        if (!capture->open(config.traffic_capture.path, config.traffic_capture.capacity_mb * 1024 * 1024)) {
+            std::cerr << "Failed to open traffic capture." << std::endl;
+            stop_engines();
+            return 1;
+        }
+        std::cout << "Capturing Modbus traffic to " << config.traffic_capture.path << "." << std::endl;
+    }
+    if (config.rate_limit.enabled) {
+        std::cout << "Modbus rate limits: " << config.rate_limit.connection_rate << " req/s per connection, "
+                  << config.rate_limit.source_rate << " req/s per client address (0 = unlimited)." << std::endl;
+    }
+    // One descriptor per client connection (and per device listener): allow as many as the hard limit permits
+    rlimit files{};
+    if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max) {
+        files.rlim_cur = files.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &files);
+    }
+    // A port-per-device listener belongs to one device, so with NUMA shards every shard serves its own
+    // listeners from a server thread on its node; shared listeners dispatch on unit ID and stay on one server
+    std::vector<FleetShard> server_shards{FleetShard{0, {}, 0, g_devices.size()}};
+    if (config.port_per_device.enabled && node_shards.size() > 1) {
+        server_shards = node_shards;
+    }
+    server_shards = placed(server_shards, realtime.server_cpus);
+    bool served = true;
+    for (size_t s = 0; s < server_shards.size() && served; ++s) {
+        // The server thread inherits the placement of the thread that starts it
+        NumaTopology::runOn(server_shards[s].placement, [&] {
+            served = start_modbus_server(config, server_shards[s], s == 0, capture);
+        });
+    }
+    if (!served) {
+        stop_engines();
         return 1;
     }
-    std::cout << "Modbus TCP server started on port " << modbus_port << "." << std::endl;
 
-    // Set up Signal Handler and Wait ---
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+    // Optional Modbus RTU buses on pseudo-terminals, sharing the devices' data models
+    if (!config.rtu_buses.empty()) {
+        g_rtu_server_ptr = std::make_unique<ModbusRtuServer>();
+        for (const auto& bus : config.rtu_buses) {
+            std::vector<std::pair<DeviceIdentity, std::shared_ptr<SafeDataModel>>> bus_devices;
+            for (const auto& device : g_devices) {
+                bool on_bus = bus.unit_ids.empty();
+                for (int unit_id : bus.unit_ids) {
+                    on_bus = on_bus || unit_id == device.identity.unit_id;
+                }
+                if (on_bus) {
+                    bus_devices.emplace_back(device.identity, device.data_model);
+                }
+            }
+            if (!g_rtu_server_ptr->addBus(bus, bus_devices)) {
+                continue;
+            }
+            std::cout << "Modbus RTU bus on " << bus.link_path << " (" << bus.baud_rate << " baud, "
+                      << bus.parity << bus.stop_bits << ", " << bus_devices.size() << " units)." << std::endl;
+        }
+        bool started = false;
+        NumaTopology::runOn(ThreadPlacement{realtime.server_cpus, realtime.policy, realtime.priority},
+                            [&] { started = g_rtu_server_ptr->start(); });
+        if (!started) {
+            std::cerr << "Failed to start Modbus RTU server." << std::endl;
+            g_rtu_server_ptr.reset();
+        }
+    }
 
-    std::cout << "\nDigital Twin is running. Press Ctrl+C to exit." << std::endl;
+    // Wait for signals ---
+    EventLoop main_loop;
+    int signal_fd = signalfd(-1, &handled_signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd == -1 || !main_loop.open()) {
+        std::cerr << "Failed to set up signal handling: " << strerror(errno) << std::endl;
+        shutdown();
+        return 1;
+    }
+    main_loop.addFd(signal_fd, EPOLLIN, [&](uint32_t) {
+        signalfd_siginfo info;
+        while (read(signal_fd, &info, sizeof(info)) == static_cast<ssize_t>(sizeof(info))) {
+            switch (info.ssi_signo) {
+                case SIGUSR1:
+                    export_history();
+                    break;
+                case SIGHUP:
+                    if (g_config_reloader_ptr) {
+                        g_config_reloader_ptr->requestReload();
+                    }
+                    break;
+                default:
+                    std::cout << "\nCaught signal " << info.ssi_signo << ". Shutting down gracefully..." << std::endl;
+                    main_loop.stop();
+                    break;
+            }
+        }
+    });
 
-    // The main thread can simply wait here. The signal handler will trigger the shutdown.
-    // The destructor of the unique_ptrs will handle joining the threads.
-    while(g_running) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+    // Runtime operations over a Unix socket, served on this thread's loop
+    std::unique_ptr<AdminServer> admin_server;
+    if (config.admin_socket.enabled) {
+        std::vector<ModbusServer*> modbus_servers;
+        for (auto& server : g_modbus_servers) {
+            modbus_servers.push_back(server.get());
+        }
+        admin_server = std::make_unique<AdminServer>(main_loop, engines, g_scheduler.get(), modbus_servers);
+        if (admin_server->start(config.admin_socket.socket_path)) {
+            std::cout << "Admin socket listening on " << config.admin_socket.socket_path << "." << std::endl;
+        } else {
+            admin_server.reset();
+        }
     }
 
+    std::cout << "\nDigital Twin is running. Press Ctrl+C to exit." << std::endl;
+    main_loop.run();
 
-    return 0; // This part is unreachable due to the infinite loop and signal handler
+    if (admin_server) {
+        admin_server->stop();
+    }
+    shutdown();
+    close(signal_fd);
+    return 0;
 }
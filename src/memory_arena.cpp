@@ -0,0 +1,83 @@
+#include "memory_arena.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+
+namespace {
+    constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    size_t roundUp(size_t value, size_t multiple) {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+}
+
+MemoryArena::MemoryArena(HugePageMode mode, size_t chunk_size)
+    : huge_pages(mode), chunk_bytes(roundUp(std::max<size_t>(chunk_size, 1), HUGE_PAGE_SIZE)), cursor(nullptr),
+      limit(nullptr), used(0) {}
+
+MemoryArena::~MemoryArena() {
+    for (const Chunk& chunk : chunks) {
+        munmap(chunk.base, chunk.size);
+    }
+}
+
+MemoryArena::Chunk MemoryArena::map(size_t bytes) {
+    size_t size = roundUp(bytes, HUGE_PAGE_SIZE);
+    void* base = MAP_FAILED;
+    if (huge_pages == HugePageMode::Explicit) {
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base == MAP_FAILED) {
+            std::cerr << "No explicit huge pages available (" << strerror(errno)
+                      << "); using normal pages. Reserve some with vm.nr_hugepages." << std::endl;
+            huge_pages = HugePageMode::Transparent;
+        }
+    }
+    if (base == MAP_FAILED) {
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        if (huge_pages == HugePageMode::Transparent) {
+            // Only a hint: the kernel may still back the range with normal pages
+            madvise(base, size, MADV_HUGEPAGE);
+        }
+    }
+    chunks.push_back({static_cast<uint8_t*>(base), size});
+    return chunks.back();
+}
+
+void* MemoryArena::allocate(size_t bytes, size_t alignment) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uintptr_t aligned = roundUp(reinterpret_cast<uintptr_t>(cursor), alignment);
+    if (!cursor || aligned + bytes > reinterpret_cast<uintptr_t>(limit)) {
+        if (bytes > chunk_bytes / 4) {
+            // Large blocks get their own mapping, so they don't waste the rest of the current chunk
+            used += bytes;
+            return map(bytes).base;
+        }
+        Chunk chunk = map(chunk_bytes);
+        cursor = chunk.base;
+        limit = chunk.base + chunk.size;
+        aligned = reinterpret_cast<uintptr_t>(cursor);
+    }
+    cursor = reinterpret_cast<uint8_t*>(aligned + bytes);
+    used += bytes;
+    return reinterpret_cast<void*>(aligned);
+}
+
+size_t MemoryArena::bytesUsed() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return used;
+}
+
+size_t MemoryArena::bytesMapped() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t mapped = 0;
+    for (const Chunk& chunk : chunks) {
+        mapped += chunk.size;
+    }
+    return mapped;
+}
@@ -0,0 +1,231 @@
+#include "modbus_request_handler.hpp"
+#include <modbus/modbus.h>
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+    constexpr uint8_t FC_ENCAPSULATED_INTERFACE = 0x2B;
+    constexpr uint8_t MEI_READ_DEVICE_ID = 0x0E;
+    // Read Device ID codes: stream access per category, or one specific object
+    constexpr uint8_t READ_DEVICE_ID_BASIC = 0x01;
+    constexpr uint8_t READ_DEVICE_ID_REGULAR = 0x02;
+    constexpr uint8_t READ_DEVICE_ID_EXTENDED = 0x03;
+    constexpr uint8_t READ_DEVICE_ID_SPECIFIC = 0x04;
+    // Extended identification, stream and individual access
+    constexpr uint8_t DEVICE_ID_CONFORMITY = 0x83;
+    constexpr uint16_t MANUFACTURER_SMA = 461;
+
+    /// Formats an SMA software package number, e.g. 0x030B0404 -> "3.11.04.R".
+    std::string softwareVersion(uint32_t package) {
+        static const char release_types[] = {'N', 'E', 'A', 'B', 'R', 'S'};
+        uint8_t release = package & 0xFF;
+        char text[32];
+        snprintf(text, sizeof(text), "%u.%u.%02u.%c", package >> 24, (package >> 16) & 0xFF, (package >> 8) & 0xFF,
+                 release < sizeof(release_types) ? release_types[release] : '?');
+        return text;
+    }
+
+    uint16_t readWord(const uint8_t* p) {
+        return static_cast<uint16_t>((p[0] << 8) | p[1]);
+    }
+
+    void writeWord(uint8_t* p, uint16_t value) {
+        p[0] = static_cast<uint8_t>(value >> 8);
+        p[1] = static_cast<uint8_t>(value & 0xFF);
+    }
+}
+
+ModbusRequestHandler::ModbusRequestHandler(std::shared_ptr<SafeDataModel> model, const DeviceIdentity& identity)
+    : data_model(model) {
+    // The objects never change at runtime, so they are formatted once
+    bool sma = identity.manufacturer == MANUFACTURER_SMA;
+    identification_objects = {
+        {0x00, sma ? "SMA Solar Technology AG" : "Manufacturer " + std::to_string(identity.manufacturer)},
+        {0x01, std::to_string(identity.susy_id)},                        // ProductCode: SUSy-ID
+        {0x02, softwareVersion(identity.software_package)},              // MajorMinorRevision
+        {0x03, sma ? "https://www.sma.de" : ""},                         // VendorUrl
+        {0x04, "Device class " + std::to_string(identity.device_class)}, // ProductName
+        {0x05, "SUSy-ID " + std::to_string(identity.susy_id)},           // ModelName
+        {0x06, "Sunny Boy digital twin"},                                // UserApplicationName
+        {0x80, std::to_string(identity.serial_number)},                  // Serial number
+        {0x81, std::to_string(identity.unit_id)},                        // Configured unit ID
+    };
+}
+
+size_t ModbusRequestHandler::exception(uint8_t function_code, uint8_t exception_code, uint8_t* response) {
+    response[0] = function_code | 0x80;
+    response[1] = exception_code;
+    return 2;
+}
+
+size_t ModbusRequestHandler::handle(const uint8_t* request, size_t length, uint8_t* response) {
+    if (length < 1) {
+        return exception(0, MODBUS_EXCEPTION_ILLEGAL_FUNCTION, response);
+    }
+
+    switch (request[0]) {
+        case MODBUS_FC_READ_HOLDING_REGISTERS:
+        case MODBUS_FC_READ_INPUT_REGISTERS:
+            return readRegisters(request, length, response);
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+            return writeSingleRegister(request, length, response);
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+            return writeMultipleRegisters(request, length, response);
+        case MODBUS_FC_WRITE_AND_READ_REGISTERS:
+            return writeAndReadRegisters(request, length, response);
+        case FC_ENCAPSULATED_INTERFACE:
+            return readDeviceIdentification(request, length, response);
+        default:
+            return exception(request[0], MODBUS_EXCEPTION_ILLEGAL_FUNCTION, response);
+    }
+}
+
+size_t ModbusRequestHandler::readRegisters(const uint8_t* request, size_t length, uint8_t* response) {
+    uint8_t function_code = request[0];
+    if (length < 5) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    uint16_t addr = readWord(request + 1);
+    uint16_t nb = readWord(request + 3);
+    if (nb < 1 || nb > MODBUS_MAX_READ_REGISTERS) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+
+    // Every requested register must be mapped (one contiguous span), otherwise the whole read is rejected
+    uint16_t values[MODBUS_MAX_READ_REGISTERS];
+    if (!data_model->readRange(addr, nb, values)) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, response);
+    }
+    for (int i = 0; i < nb; ++i) {
+        writeWord(response + 2 + 2 * i, values[i]);
+    }
+    response[0] = function_code;
+    response[1] = static_cast<uint8_t>(nb * 2);
+    return 2 + nb * 2;
+}
+
+size_t ModbusRequestHandler::writeSingleRegister(const uint8_t* request, size_t length, uint8_t* response) {
+    uint8_t function_code = request[0];
+    if (length < 5) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    if (!data_model->setRegisterValue(readWord(request + 1), readWord(request + 3))) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, response);
+    }
+
+    // The normal response is an echo of the request
+    for (size_t i = 0; i < 5; ++i) {
+        response[i] = request[i];
+    }
+    return 5;
+}
+
+size_t ModbusRequestHandler::writeMultipleRegisters(const uint8_t* request, size_t length, uint8_t* response) {
+    uint8_t function_code = request[0];
+    if (length < 6) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    uint16_t addr = readWord(request + 1);
+    uint16_t nb = readWord(request + 3);
+    uint8_t byte_count = request[5];
+    if (nb < 1 || nb > MODBUS_MAX_WRITE_REGISTERS || byte_count != nb * 2 || length < 6u + byte_count) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+
+    // Validated and written as a whole, so a rejected request changes nothing
+    uint16_t values[MODBUS_MAX_WRITE_REGISTERS];
+    for (int i = 0; i < nb; ++i) {
+        values[i] = readWord(request + 6 + 2 * i);
+    }
+    if (!data_model->writeRange(addr, nb, values)) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, response);
+    }
+
+    response[0] = function_code;
+    writeWord(response + 1, addr);
+    writeWord(response + 3, nb);
+    return 5;
+}
+
+size_t ModbusRequestHandler::writeAndReadRegisters(const uint8_t* request, size_t length, uint8_t* response) {
+    uint8_t function_code = request[0];
+    if (length < 10) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    uint16_t read_addr = readWord(request + 1);
+    uint16_t read_nb = readWord(request + 3);
+    uint16_t write_addr = readWord(request + 5);
+    uint16_t write_nb = readWord(request + 7);
+    uint8_t byte_count = request[9];
+    if (read_nb < 1 || read_nb > MODBUS_MAX_WR_READ_REGISTERS || write_nb < 1 ||
+        write_nb > MODBUS_MAX_WR_WRITE_REGISTERS || byte_count != write_nb * 2 || length < 10u + byte_count) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+
+    uint16_t write_values[MODBUS_MAX_WR_WRITE_REGISTERS];
+    for (int i = 0; i < write_nb; ++i) {
+        write_values[i] = readWord(request + 10 + 2 * i);
+    }
+    // The write is applied before the read, both against the same snapshot
+    uint16_t read_values[MODBUS_MAX_WR_READ_REGISTERS];
+    if (!data_model->writeReadRange(write_addr, write_nb, write_values, read_addr, read_nb, read_values)) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, response);
+    }
+
+    response[0] = function_code;
+    response[1] = static_cast<uint8_t>(read_nb * 2);
+    for (int i = 0; i < read_nb; ++i) {
+        writeWord(response + 2 + 2 * i, read_values[i]);
+    }
+    return 2 + read_nb * 2;
+}
+
+size_t ModbusRequestHandler::readDeviceIdentification(const uint8_t* request, size_t length, uint8_t* response) {
+    uint8_t function_code = request[0];
+    if (length < 2 || request[1] != MEI_READ_DEVICE_ID) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_FUNCTION, response);
+    }
+    if (length < 4 || request[2] < READ_DEVICE_ID_BASIC || request[2] > READ_DEVICE_ID_SPECIFIC) {
+        return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_VALUE, response);
+    }
+    uint8_t read_code = request[2];
+    uint8_t object_id = request[3];
+
+    // Objects of the requested category: basic 0x00-0x02, regular up to 0x7F, extended everything
+    uint8_t last_id = read_code == READ_DEVICE_ID_BASIC ? 0x02 : read_code == READ_DEVICE_ID_REGULAR ? 0x7F : 0xFF;
+    auto first = identification_objects.begin();
+    while (first != identification_objects.end() && first->first < object_id) ++first;
+    if (read_code == READ_DEVICE_ID_SPECIFIC) {
+        if (first == identification_objects.end() || first->first != object_id) {
+            return exception(function_code, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS, response);
+        }
+    } else if (first == identification_objects.end() || first->first > last_id) {
+        // An unknown starting object restarts the stream at object 0
+        first = identification_objects.begin();
+    }
+
+    response[0] = function_code;
+    response[1] = MEI_READ_DEVICE_ID;
+    response[2] = read_code;
+    response[3] = DEVICE_ID_CONFORMITY;
+    response[4] = 0x00; // More follows
+    response[5] = 0x00; // Next object ID
+    response[6] = 0;    // Number of objects
+    size_t pos = 7;
+    for (auto it = first; it != identification_objects.end() && it->first <= last_id; ++it) {
+        size_t object_length = std::min<size_t>(it->second.size(), 0xFF);
+        if (pos + 2 + object_length > MAX_PDU_LENGTH) {
+            // The rest is fetched by a follow-up request starting at this object
+            response[4] = 0xFF;
+            response[5] = it->first;
+            break;
+        }
+        response[pos++] = it->first;
+        response[pos++] = static_cast<uint8_t>(object_length);
+        std::copy_n(it->second.data(), object_length, response + pos);
+        pos += object_length;
+        ++response[6];
+        if (read_code == READ_DEVICE_ID_SPECIFIC) break;
+    }
+    return pos;
+}
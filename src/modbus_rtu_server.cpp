@@ -0,0 +1,230 @@
+#include "modbus_rtu_server.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+    // Largest RTU frame: address + 253-byte PDU + CRC
+    constexpr size_t MAX_RTU_FRAME = 256;
+    // Coalesce transmit pacing so fast buses do not need a timer per character
+    constexpr auto MIN_TX_STEP = std::chrono::microseconds(500);
+
+    uint16_t crc16(const uint8_t* data, size_t length) {
+        static const auto table = [] {
+            std::array<uint16_t, 256> t{};
+            for (uint16_t i = 0; i < 256; ++i) {
+                uint16_t crc = i;
+                for (int bit = 0; bit < 8; ++bit) {
+                    crc = (crc & 1) ? static_cast<uint16_t>((crc >> 1) ^ 0xA001) : static_cast<uint16_t>(crc >> 1);
+                }
+                t[i] = crc;
+            }
+            return t;
+        }();
+
+        uint16_t crc = 0xFFFF;
+        for (size_t i = 0; i < length; ++i) {
+            crc = static_cast<uint16_t>((crc >> 8) ^ table[(crc ^ data[i]) & 0xFF]);
+        }
+        return crc;
+    }
+
+    speed_t toSpeed(int baud) {
+        switch (baud) {
+            case 1200: return B1200;
+            case 2400: return B2400;
+            case 4800: return B4800;
+            case 9600: return B9600;
+            case 19200: return B19200;
+            case 38400: return B38400;
+            case 57600: return B57600;
+            case 115200: return B115200;
+            default: return B19200; // A pty ignores the speed; timing is modelled from baud_rate regardless
+        }
+    }
+}
+
+ModbusRtuServer::ModbusRtuServer() : running(false) {}
+
+ModbusRtuServer::~ModbusRtuServer() {
+    stop();
+    for (auto& bus : buses) {
+        unlink(bus->params.link_path.c_str());
+        if (bus->slave_fd != -1) close(bus->slave_fd);
+        if (bus->master_fd != -1) close(bus->master_fd);
+    }
+}
+
+bool ModbusRtuServer::addBus(const RtuBusParams& params,
+                             const std::vector<std::pair<DeviceIdentity, std::shared_ptr<SafeDataModel>>>& devices) {
+    auto bus = std::make_unique<Bus>();
+    bus->params = params;
+
+    bus->master_fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (bus->master_fd == -1 || grantpt(bus->master_fd) == -1 || unlockpt(bus->master_fd) == -1) {
+        std::cerr << "Failed to create pty for RTU bus " << params.link_path << ": " << strerror(errno) << std::endl;
+        if (bus->master_fd != -1) close(bus->master_fd);
+        return false;
+    }
+    const char* slave_name = ptsname(bus->master_fd);
+    bus->slave_fd = slave_name ? open(slave_name, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC) : -1;
+    if (bus->slave_fd == -1) {
+        std::cerr << "Failed to open pty slave for RTU bus " << params.link_path << ": " << strerror(errno) << std::endl;
+        close(bus->master_fd);
+        return false;
+    }
+
+    // Raw 8-bit line without echo or CR/LF translation, like a serial adapter
+    termios tio;
+    tcgetattr(bus->slave_fd, &tio);
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, toSpeed(params.baud_rate));
+    cfsetospeed(&tio, toSpeed(params.baud_rate));
+    tio.c_cflag &= ~(PARENB | PARODD | CSTOPB);
+    if (params.parity != 'N') tio.c_cflag |= PARENB;
+    if (params.parity == 'O') tio.c_cflag |= PARODD;
+    if (params.stop_bits == 2) tio.c_cflag |= CSTOPB;
+    tcsetattr(bus->slave_fd, TCSANOW, &tio);
+
+    unlink(params.link_path.c_str());
+    if (symlink(slave_name, params.link_path.c_str()) == -1) {
+        std::cerr << "Failed to link " << params.link_path << " to " << slave_name << ": " << strerror(errno)
+                  << std::endl;
+        close(bus->slave_fd);
+        close(bus->master_fd);
+        return false;
+    }
+
+    // Start bit + 8 data bits + optional parity + stop bits
+    int bits_per_char = 1 + 8 + (params.parity != 'N' ? 1 : 0) + params.stop_bits;
+    bus->char_time = std::chrono::nanoseconds(1000000000LL * bits_per_char / params.baud_rate);
+    // The specification fixes the inter-frame gap at 1.75 ms above 19200 baud
+    bus->frame_gap = params.baud_rate > 19200 ? std::chrono::nanoseconds(1750000) : bus->char_time * 7 / 2;
+
+    for (const auto& device : devices) {
+        int unit_id = device.first.unit_id;
+        if (unit_id >= 1 && unit_id <= 247 && !bus->handlers[unit_id]) {
+            bus->handlers[unit_id] = std::make_unique<ModbusRequestHandler>(device.second, device.first);
+        }
+    }
+    buses.push_back(std::move(bus));
+    return true;
+}
+
+bool ModbusRtuServer::start() {
+    if (running) return true;
+    if (!loop.open()) {
+        return false;
+    }
+    for (auto& bus : buses) {
+        Bus* b = bus.get();
+        if (!loop.addFd(b->master_fd, EPOLLIN, [this, b](uint32_t) { onReadable(*b); })) {
+            return false;
+        }
+    }
+    running = true;
+    loop_thread = std::thread(&EventLoop::run, &loop);
+    return true;
+}
+
+void ModbusRtuServer::stop() {
+    if (!running) return;
+    running = false;
+    loop.stop();
+    if (loop_thread.joinable()) {
+        loop_thread.join();
+    }
+    for (const auto& bus : buses) {
+        std::cout << "RTU bus " << bus->params.link_path << ": " << bus->requests << " requests, " << bus->crc_errors
+                  << " CRC errors" << std::endl;
+    }
+}
+
+void ModbusRtuServer::onReadable(Bus& bus) {
+    uint8_t buffer[MAX_RTU_FRAME];
+    ssize_t n;
+    while ((n = read(bus.master_fd, buffer, sizeof(buffer))) > 0) {
+        // Bytes reach the pty instantly; give each one its time on the simulated wire
+        Clock::time_point now = Clock::now();
+        bus.rx_wire_end = std::max(bus.rx_wire_end, now) + bus.char_time * n;
+        if (bus.rx.size() + static_cast<size_t>(n) <= MAX_RTU_FRAME) {
+            bus.rx.insert(bus.rx.end(), buffer, buffer + n);
+        } else {
+            bus.rx.assign(MAX_RTU_FRAME + 1, 0); // Overrun: the frame is discarded when it ends
+        }
+    }
+
+    // The frame ends once the line has been silent for 3.5 characters
+    if (bus.gap_timer) {
+        loop.cancelTimer(bus.gap_timer);
+    }
+    bus.gap_timer = loop.addTimer(bus.rx_wire_end + bus.frame_gap, [this, &bus] {
+        bus.gap_timer = 0;
+        onFrameComplete(bus);
+    });
+}
+
+void ModbusRtuServer::onFrameComplete(Bus& bus) {
+    std::vector<uint8_t> frame;
+    frame.swap(bus.rx);
+    if (frame.size() < 4 || frame.size() > MAX_RTU_FRAME) {
+        return;
+    }
+
+    size_t length = frame.size() - 2;
+    uint16_t received_crc = static_cast<uint16_t>(frame[length] | (frame[length + 1] << 8));
+    if (crc16(frame.data(), length) != received_crc) {
+        ++bus.crc_errors;
+        return;
+    }
+
+    uint8_t unit_id = frame[0];
+    uint8_t response[MAX_RTU_FRAME];
+    if (unit_id == 0) {
+        // Broadcast: every unit executes it, nobody answers
+        for (auto& handler : bus.handlers) {
+            if (handler) handler->handle(frame.data() + 1, length - 1, response + 1);
+        }
+        ++bus.requests;
+        return;
+    }
+    if (unit_id > 247 || !bus.handlers[unit_id] || !bus.tx.empty()) {
+        return;
+    }
+
+    ++bus.requests;
+    size_t pdu_length = bus.handlers[unit_id]->handle(frame.data() + 1, length - 1, response + 1);
+    response[0] = unit_id;
+    uint16_t crc = crc16(response, pdu_length + 1);
+    response[pdu_length + 1] = static_cast<uint8_t>(crc & 0xFF);
+    response[pdu_length + 2] = static_cast<uint8_t>(crc >> 8);
+
+    bus.tx.assign(response, response + pdu_length + 3);
+    bus.tx_sent = 0;
+    bus.tx_start = Clock::now();
+    transmit(bus);
+}
+
+void ModbusRtuServer::transmit(Bus& bus) {
+    // Release the bytes that have been fully clocked out by now
+    Clock::time_point now = Clock::now();
+    size_t due = std::min(bus.tx.size(), static_cast<size_t>((now - bus.tx_start) / bus.char_time));
+    if (due > bus.tx_sent) {
+        ssize_t n = write(bus.master_fd, bus.tx.data() + bus.tx_sent, due - bus.tx_sent);
+        if (n > 0) {
+            bus.tx_sent += static_cast<size_t>(n);
+        }
+    }
+
+    if (bus.tx_sent == bus.tx.size()) {
+        bus.tx.clear();
+        return;
+    }
+    Clock::time_point next = std::max(bus.tx_start + bus.char_time * static_cast<int64_t>(bus.tx_sent + 1), now + MIN_TX_STEP);
+    loop.addTimer(next, [this, &bus] { transmit(bus); });
+}
@@ -1,71 +1,270 @@
 #include "modbus_server.hpp"
+#include "log_level.hpp"
 #include <iostream>
 #include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
 
-ModbusServer::ModbusServer(std::shared_ptr<SafeDataModel> model, int id)
-    : data_model(model), unit_id(id), port(0), ctx(nullptr), mb_mapping(nullptr), running(false), server_socket(-1) {}
+namespace {
+    // Connection ids are unique across every server of the process, so captures of several
+    // servers (one per NUMA shard) sharing one TrafficCapture never mix their clients
+    std::atomic<uint32_t> next_connection_id{0};
+
+    constexpr size_t MBAP_HEADER_LENGTH = 7;
+    constexpr size_t READ_CHUNK = 4096;
+    // Frames served per connection (or UDP socket) before the next one gets its turn
+    constexpr int FRAMES_PER_TURN = 16;
+    // Idle rate-limit entries of past clients are pruned once this many addresses are tracked
+    constexpr size_t MAX_TRACKED_SOURCES = 4096;
+    // Unix clients are keyed by their user ID, outside the IPv4 key range
+    constexpr uint64_t UNIX_SOURCE_KEY = 1ULL << 32;
+    // Parked responses per connection before it stops being read
+    constexpr uint32_t MAX_PARKED_PER_CONNECTION = 64;
+    // Response wheel: 1 ms ticks, one revolution per ~4 s
+    constexpr auto WHEEL_RESOLUTION = std::chrono::milliseconds(1);
+    constexpr size_t WHEEL_SLOTS = 4096;
+    // Output budget per connection: unsent responses beyond this disconnect the client.
+    // One turn of replies always fits (16 frames of at most 260 bytes), so only a client
+    // that stops reading while parked responses keep arriving can exceed it.
+    constexpr size_t OUTPUT_BUDGET = 16384;
+    constexpr size_t OUTPUT_BLOCKS_PER_SLAB = 64;
+    // A client that accepts none of its waiting responses for this long is disconnected
+    constexpr auto SEND_STALL_TIMEOUT = std::chrono::seconds(10);
+
+    double sampleLatencyMs(const ResponseModelParams& model, std::mt19937_64& engine) {
+        double latency = model.latency_ms;
+        switch (model.distribution) {
+            case LatencyDistribution::Fixed:
+                break;
+            case LatencyDistribution::Uniform:
+                latency = std::uniform_real_distribution<double>(model.latency_ms - model.jitter_ms,
+                                                                 model.latency_ms + model.jitter_ms)(engine);
+                break;
+            case LatencyDistribution::Normal:
+                latency = std::normal_distribution<double>(model.latency_ms, model.jitter_ms)(engine);
+                break;
+            case LatencyDistribution::LogNormal:
+                if (model.latency_ms > 0) {
+                    // Parameters of the underlying normal distribution for the requested mean and deviation
+                    double ratio = model.jitter_ms / model.latency_ms;
+                    double sigma2 = std::log1p(ratio * ratio);
+                    latency = std::lognormal_distribution<double>(std::log(model.latency_ms) - sigma2 / 2,
+                                                                  std::sqrt(sigma2))(engine);
+                }
+                break;
+        }
+        return std::clamp(latency, model.min_latency_ms, model.max_latency_ms);
+    }
+
+    const char* transportName(ModbusTransport transport) {
+        switch (transport) {
+            case ModbusTransport::UDP: return "UDP";
+            case ModbusTransport::UNIX: return "Unix";
+            default: return "TCP";
+        }
+    }
+
+    std::string endpointName(const ModbusListenerParams& params) {
+        return params.transport == ModbusTransport::UNIX ? params.socket_path
+                                                         : params.address + ":" + std::to_string(params.port);
+    }
+
+    /// Returns the total frame length announced by an MBAP header, or 0 if the header is malformed.
+    size_t mbapFrameLength(const uint8_t* header) {
+        uint16_t protocol = static_cast<uint16_t>((header[2] << 8) | header[3]);
+        size_t length = static_cast<size_t>((header[4] << 8) | header[5]); // Unit ID + PDU
+        if (protocol != 0 || length < 2 || length > 1 + MODBUS_MAX_PDU_LENGTH) {
+            return 0;
+        }
+        return 6 + length;
+    }
+}
+
+ModbusServer::ModbusServer(std::shared_ptr<SafeDataModel> model, const DeviceConfig& device)
+    : device_count(0), first_device(nullptr), request_count(0), shed_count(0), lost_count(0), disconnect_count(0),
+      overflow_count(0), output_pool(OUTPUT_BUDGET, OUTPUT_BLOCKS_PER_SLAB), response_wheel(WHEEL_RESOLUTION, WHEEL_SLOTS), wheel_timer(0), random_engine(std::random_device{}()),
+      running(false), connection_count(0) {
+    addDevice(device, model);
+}
 
 ModbusServer::~ModbusServer() {
     stop();
+    for (auto& listener : listeners) {
+        close(listener->fd);
+        if (listener->params.transport == ModbusTransport::UNIX) {
+            unlink(listener->params.socket_path.c_str());
+        }
+    }
 }
 
-bool ModbusServer::start(int p) {
-    if (running) return true;
-    port = p;
+int ModbusServer::bindListener(const ModbusListenerParams& params) {
+    int fd = -1;
+    if (params.transport == ModbusTransport::UNIX) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (params.socket_path.size() >= sizeof(addr.sun_path)) {
+            std::cerr << "Modbus socket path too long: " << params.socket_path << std::endl;
+            return -1;
+        }
+        std::strncpy(addr.sun_path, params.socket_path.c_str(), sizeof(addr.sun_path) - 1);
+        unlink(params.socket_path.c_str());
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd != -1 && (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 ||
+                         listen(fd, SOMAXCONN) == -1)) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(params.port));
+        if (inet_pton(AF_INET, params.address.c_str(), &addr.sin_addr) != 1) {
+            std::cerr << "Invalid Modbus listen address: " << params.address << std::endl;
+            return -1;
+        }
+        bool udp = params.transport == ModbusTransport::UDP;
+        fd = socket(AF_INET, (udp ? SOCK_DGRAM : SOCK_STREAM) | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int one = 1;
+        if (fd != -1 && (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) == -1 ||
+                         bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1 ||
+                         (!udp && listen(fd, SOMAXCONN) == -1))) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd == -1) {
+        std::cerr << "Unable to listen on Modbus " << transportName(params.transport) << " " << endpointName(params) << ": "
+                  << strerror(errno) << std::endl;
+    }
+    return fd;
+}
 
-    ctx = modbus_new_tcp("127.0.0.1", port);
-    if (ctx == nullptr) {
-        std::cerr << "Failed to create modbus context: " << modbus_strerror(errno) << std::endl;
+bool ModbusServer::addListener(const ModbusListenerParams& params) {
+    int fd = bindListener(params);
+    if (fd == -1) {
         return false;
     }
+    listeners.push_back(std::make_unique<Listener>(Listener{params, fd, 0, nullptr}));
+    std::cout << "Modbus " << transportName(params.transport) << " listening on " << endpointName(params) << "."
+              << std::endl;
+    return true;
+}
 
-    // Create mapping: (coils, discrete_inputs, holding_registers, input_registers)
-    mb_mapping = modbus_mapping_new(0, 0, 65536, 65536);
-    if (mb_mapping == nullptr) {
-        std::cerr << "Failed to allocate modbus mapping: " << modbus_strerror(errno) << std::endl;
-        modbus_free(ctx);
+bool ModbusServer::addDeviceListener(const ModbusListenerParams& params, const DeviceConfig& device,
+                                     std::shared_ptr<SafeDataModel> model) {
+    int fd = bindListener(params);
+    if (fd == -1) {
         return false;
     }
-    
-    modbus_set_slave(ctx, unit_id);
+    listeners.push_back(std::make_unique<Listener>(Listener{params, fd, 0, makeDevice(device, model)}));
+    return true;
+}
 
-    server_socket = modbus_tcp_listen(ctx, 1);
-    if (server_socket == -1) {
-        std::cerr << "Unable to listen on TCP port " << port << ": " << modbus_strerror(errno) << std::endl;
-        modbus_free(ctx);
-        modbus_mapping_free(mb_mapping);
+bool ModbusServer::start() {
+    if (running) return true;
+    if (listeners.empty() || !loop.open()) {
         return false;
     }
 
+    for (auto& entry : listeners) {
+        Listener* listener = entry.get();
+        bool added;
+        if (listener->params.transport == ModbusTransport::UDP) {
+            listener->connection_id = ++next_connection_id;
+            ++connection_count;
+            added = loop.addFd(listener->fd, EPOLLIN, [this, listener](uint32_t) { onDatagram(*listener); });
+        } else {
+            added = loop.addFd(listener->fd, EPOLLIN, [this, listener](uint32_t) { onAccept(*listener); });
+        }
+        if (!added) {
+            return false;
+        }
+    }
+
     running = true;
-    server_thread = std::thread(&ModbusServer::run, this);
+    server_thread = std::thread([this] {
+        std::cout << "Modbus server thread started." << std::endl;
+        loop.run();
+        std::cout << "Modbus server thread stopped." << std::endl;
+    });
     return true;
 }
 
 void ModbusServer::stop() {
     if (!running) return;
     running = false;
-    
-    if(server_socket != -1){
-        shutdown(server_socket, SHUT_RDWR);
-        close(server_socket);
-        server_socket = -1;
-    }
+    loop.stop();
 
     if (server_thread.joinable()) {
         server_thread.join();
     }
 
-    if (ctx) {
-        modbus_close(ctx);
-        modbus_free(ctx);
-        ctx = nullptr;
+    for (auto& entry : connections) {
+        if (entry.second->tx) {
+            output_pool.release(entry.second->tx);
+        }
+        close(entry.first);
     }
-    if (mb_mapping) {
-        modbus_mapping_free(mb_mapping);
-        mb_mapping = nullptr;
+    connections.clear();
+    std::cout << "Modbus server: " << request_count << " requests, " << shed_count << " shed by rate limits, "
+              << lost_count << " dropped and " << disconnect_count << " disconnects by response models, "
+              << overflow_count << " slow clients disconnected." << std::endl;
+}
+
+void ModbusServer::queryMetrics(std::function<void(const Metrics&)> done) {
+    if (!running) {
+        done(metrics());
+        return;
     }
+    loop.post([this, done = std::move(done)] { done(metrics()); });
+}
+
+ModbusServer::Metrics ModbusServer::metrics() const {
+    return {request_count, shed_count, lost_count, disconnect_count, overflow_count, connection_count,
+            connections.size(), response_wheel.size(), output_pool.inUse()};
+}
+
+std::unique_ptr<ModbusServer::Device> ModbusServer::makeDevice(const DeviceConfig& config,
+                                                               std::shared_ptr<SafeDataModel> model) {
+    auto device = std::make_unique<Device>();
+    device->handler = std::make_unique<ModbusRequestHandler>(model, config.identity);
+    device->response_model = config.device_template->response_model;
+    const ResponseModelParams& response = device->response_model;
+    device->simulated_timing = response.latency_ms > 0 || response.min_latency_ms > 0 || response.loss_percent > 0 ||
+                               response.disconnect_percent > 0;
+    return device;
+}
+
+bool ModbusServer::addDevice(const DeviceConfig& config, std::shared_ptr<SafeDataModel> model) {
+    int id = config.identity.unit_id;
+    if (id < 0 || id > 255 || devices[id]) {
+        return false;
+    }
+    devices[id] = makeDevice(config, model);
+    if (device_count++ == 0) {
+        first_device = devices[id].get();
+    }
+    return true;
+}
+
+ModbusServer::Device* ModbusServer::deviceFor(uint8_t id) {
+    return device_count == 1 ? first_device : devices[id].get();
+}
+
+void ModbusServer::setRateLimit(const RateLimitParams& params) {
+    rate_limit = params;
+}
+
+void ModbusServer::setTrafficCapture(std::shared_ptr<TrafficCapture> capture) {
+    traffic_capture = capture;
 }
 
 uint16_t ModbusServer::protocolToInternal(uint16_t protocol_addr, int function_code) {
@@ -76,7 +275,7 @@ uint16_t ModbusServer::protocolToInternal(uint16_t protocol_addr, int function_c
         // Holding registers: protocol 8 -> config 40009
         return protocol_addr - 40001;
     }
-    
+
     // Fallback for other cases
     if (protocol_addr < 10000) {
         return protocol_addr - 30001;
@@ -90,7 +289,7 @@ uint16_t ModbusServer::internalToProtocol(uint16_t internal_addr, int function_c
     } else if (function_code == 0x03 && internal_addr >= 40001 && internal_addr <= 49999) {
         return internal_addr + 40001;
     }
-    
+
     // Fallback
     if (internal_addr >= 30001 && internal_addr <= 49999) {
         return internal_addr + 30001;
@@ -98,66 +297,448 @@ uint16_t ModbusServer::internalToProtocol(uint16_t internal_addr, int function_c
     return internal_addr;
 }
 
-void ModbusServer::run() {
-    std::cout << "Modbus server thread started." << std::endl;
+void ModbusServer::recordRequest(uint32_t connection_id, const uint8_t* query, size_t length) {
+    ++request_count;
+    if (traffic_capture) {
+        traffic_capture->record(connection_id, capture::Direction::Request, query, length);
+    }
+}
+
+size_t ModbusServer::processFrame(uint32_t connection_id, Device* device, bool shed, const uint8_t* query,
+                                  size_t length, uint8_t* reply) {
+    // MBAP header (7 bytes) is echoed; the PDU after it is executed against the addressed device
+    size_t pdu_length;
+    if (shed) {
+        ++shed_count;
+        pdu_length = ModbusRequestHandler::exception(
+            query[MBAP_HEADER_LENGTH], MODBUS_EXCEPTION_SLAVE_OR_SERVER_BUSY, reply + MBAP_HEADER_LENGTH);
+    } else if (device) {
+        pdu_length = device->handler->handle(query + MBAP_HEADER_LENGTH, length - MBAP_HEADER_LENGTH,
+                                     reply + MBAP_HEADER_LENGTH);
+    } else {
+        pdu_length = ModbusRequestHandler::exception(
+            query[MBAP_HEADER_LENGTH], MODBUS_EXCEPTION_GATEWAY_TARGET, reply + MBAP_HEADER_LENGTH);
+    }
+    std::memcpy(reply, query, MBAP_HEADER_LENGTH);
+    reply[4] = static_cast<uint8_t>((pdu_length + 1) >> 8);
+    reply[5] = static_cast<uint8_t>((pdu_length + 1) & 0xFF);
+    size_t reply_length = MBAP_HEADER_LENGTH + pdu_length;
+
+    if (traffic_capture) {
+        traffic_capture->record(connection_id, capture::Direction::Response, reply, reply_length);
+    }
+    return reply_length;
+}
+
+bool ModbusServer::TokenBucket::take(double rate, double burst, Clock::time_point now) {
+    tokens = std::min(burst, tokens + rate * std::chrono::duration<double>(now - last_refill).count());
+    last_refill = now;
+    if (tokens < 1.0) {
+        return false;
+    }
+    tokens -= 1.0;
+    return true;
+}
+
+ModbusServer::Source& ModbusServer::sourceFor(uint64_t key, Clock::time_point now) {
+    auto it = sources.find(key);
+    if (it != sources.end()) {
+        return it->second;
+    }
+
+    if (sources.size() >= MAX_TRACKED_SOURCES) {
+        // Forget addresses without connections whose bucket has refilled; they would start out full anyway
+        for (auto entry = sources.begin(); entry != sources.end();) {
+            const TokenBucket& bucket = entry->second.bucket;
+            double elapsed = std::chrono::duration<double>(now - bucket.last_refill).count();
+            bool refilled = bucket.tokens + rate_limit.source_rate * elapsed >= rate_limit.source_burst;
+            entry = entry->second.connections == 0 && refilled ? sources.erase(entry) : std::next(entry);
+        }
+    }
+    Source& source = sources[key];
+    source.bucket.tokens = rate_limit.source_burst;
+    source.bucket.last_refill = now;
+    return source;
+}
+
+bool ModbusServer::admit(TokenBucket* connection_bucket, Source& source, Clock::time_point now) {
+    if (connection_bucket && rate_limit.connection_rate > 0 &&
+        !connection_bucket->take(rate_limit.connection_rate, rate_limit.connection_burst, now)) {
+        return false;
+    }
+    return rate_limit.source_rate <= 0 || source.bucket.take(rate_limit.source_rate, rate_limit.source_burst, now);
+}
+
+void ModbusServer::onAccept(Listener& listener) {
+    int fd;
+    sockaddr_storage peer;
+    socklen_t peer_length = sizeof(peer);
+    while ((fd = accept4(listener.fd, reinterpret_cast<sockaddr*>(&peer), &peer_length, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        uint64_t source = 0;
+        if (listener.params.transport == ModbusTransport::TCP) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            source = ntohl(reinterpret_cast<const sockaddr_in&>(peer).sin_addr.s_addr);
+        } else {
+            ucred credentials{};
+            socklen_t credentials_length = sizeof(credentials);
+            getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_length);
+            source = UNIX_SOURCE_KEY | credentials.uid;
+        }
+        peer_length = sizeof(peer);
+
+        auto connection = std::make_unique<Connection>();
+        connection->fd = fd;
+        connection->id = ++next_connection_id;
+        ++connection_count;
+        connection->device = listener.device.get();
+        connection->source = source;
+        connection->events = EPOLLIN;
+        Connection* conn = connection.get();
+        if (rate_limit.enabled) {
+            Clock::time_point now = Clock::now();
+            ++sourceFor(source, now).connections;
+            conn->bucket.tokens = rate_limit.connection_burst;
+            conn->bucket.last_refill = now;
+        }
+        connections[fd] = std::move(connection);
+        if (!loop.addFd(fd, EPOLLIN, [this, conn](uint32_t events) { onConnectionEvent(*conn, events); })) {
+            closeConnection(*conn);
+            continue;
+        }
+        if (logEnabled(LogLevel::Info)) {
+            std::cout << "Client connected" << std::endl;
+        }
+    }
+    if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        std::cerr << "Modbus accept failed: " << strerror(errno) << std::endl;
+    }
+}
+
+void ModbusServer::onDatagram(Listener& listener) {
     uint8_t query[MODBUS_TCP_MAX_ADU_LENGTH];
-    
-    while (running) {
-        int rc = modbus_tcp_accept(ctx, &server_socket);
-        if (rc == -1) {
-            if (running) {
-                std::cerr << "Modbus accept failed: " << modbus_strerror(errno) << std::endl;
-            }
+    uint8_t reply[MODBUS_TCP_MAX_ADU_LENGTH];
+    sockaddr_storage peer;
+    socklen_t peer_length = sizeof(peer);
+    ssize_t n;
+    // Bounded per turn; the socket stays readable, so the rest is served after other clients had theirs
+    for (int frames = 0; frames < FRAMES_PER_TURN; ++frames) {
+        peer_length = sizeof(peer);
+        n = recvfrom(listener.fd, query, sizeof(query), 0, reinterpret_cast<sockaddr*>(&peer), &peer_length);
+        if (n < 0) {
+            break;
+        }
+        // Modbus UDP: exactly one MBAP frame per datagram; anything else is dropped
+        size_t length = static_cast<size_t>(n);
+        if (length <= MBAP_HEADER_LENGTH || mbapFrameLength(query) != length) {
             continue;
         }
+        bool shed = false;
+        if (rate_limit.enabled) {
+            Clock::time_point now = Clock::now();
+            uint64_t key = ntohl(reinterpret_cast<const sockaddr_in&>(peer).sin_addr.s_addr);
+            shed = !admit(nullptr, sourceFor(key, now), now);
+        }
+        recordRequest(listener.connection_id, query, length);
+        Device* device = listener.device ? listener.device.get() : deviceFor(query[6]);
+        Clock::duration latency{0};
+        if (!shed && decideFate(device, latency) != Fate::Reply) {
+            continue; // Without a connection, a simulated disconnect is just a lost datagram
+        }
 
-        std::cout << "Client connected" << std::endl;
-
-        while(running) {
-            rc = modbus_receive(ctx, query);
-            if (rc > 0) {
-                // Parse the request
-                int function_code = query[7];
-                int addr = (query[8] << 8) | query[9];
-                int nb = (query[10] << 8) | query[11];
-                
-                if (function_code == 0x03 || function_code == 0x04) { // Read Holding/Input Registers
-                    
-                    // Update mapping from data model before responding
-                    bool all_valid = true;
-                    for (int i = 0; i < nb; ++i) {
-                        uint16_t value;
-                        if (data_model->getRegisterValue(addr + i, value)) {
-                            // Store in the correct libmodbus array based on function code
-                            if (function_code == 0x04) {
-                                // Input registers (function 4)
-                                mb_mapping->tab_input_registers[addr + i] = value;
-                            } else {
-                                // Holding registers (function 3)
-                                mb_mapping->tab_registers[addr + i] = value;
-                            }
-                        } else {
-                            all_valid = false;
-                        }
-                    }
-                    
-                    if (!all_valid) {
-                        // Send exception response for illegal data address
-                        modbus_reply_exception(ctx, query, MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS);
-                        continue;
-                    }
-                }
-                
-                int reply_rc = modbus_reply(ctx, query, rc, mb_mapping);
-                if (reply_rc == -1) {
-                    std::cerr << "modbus_reply failed: " << modbus_strerror(errno) << std::endl;
-                }
-            } else if (rc == -1) {
-                std::cout << "Client disconnected" << std::endl;
-                break;
+        size_t reply_length = processFrame(listener.connection_id, device, shed, query, length, reply);
+        if (latency > Clock::duration::zero()) {
+            int fd = listener.fd;
+            park(Clock::now() + latency, [fd, peer, peer_length, bytes = std::vector<uint8_t>(reply, reply + reply_length)] {
+                sendto(fd, bytes.data(), bytes.size(), 0, reinterpret_cast<const sockaddr*>(&peer), peer_length);
+            });
+        } else if (sendto(listener.fd, reply, reply_length, 0, reinterpret_cast<sockaddr*>(&peer), peer_length) == -1) {
+            std::cerr << "Modbus reply failed: " << strerror(errno) << std::endl;
+        }
+    }
+}
+
+void ModbusServer::onConnectionEvent(Connection& connection, uint32_t events) {
+    if (events & EPOLLOUT) {
+        if (!flush(connection)) {
+            closeConnection(connection);
+            return;
+        }
+        connection.last_progress = Clock::now();
+        if (connection.unsent() == 0) {
+            updateInterest(connection);
+        }
+        return;
+    }
+    if (!(events & (EPOLLIN | EPOLLHUP | EPOLLERR))) {
+        return;
+    }
+
+    uint8_t buffer[READ_CHUNK];
+    ssize_t n = recv(connection.fd, buffer, sizeof(buffer), 0);
+    if (n <= 0) {
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return;
+        }
+        if (logEnabled(LogLevel::Info)) {
+            std::cout << "Client disconnected" << std::endl;
+        }
+        closeConnection(connection);
+        return;
+    }
+    if (connection.rx.empty()) {
+        // Usual case: frames are served straight from the read buffer and only a remainder is kept
+        serve(connection, buffer, static_cast<size_t>(n));
+    } else {
+        connection.rx.insert(connection.rx.end(), buffer, buffer + n);
+        serve(connection, connection.rx.data(), connection.rx.size());
+    }
+}
+
+void ModbusServer::serve(Connection& connection, const uint8_t* data, size_t size) {
+    // Execute up to one turn of complete frames; replies are batched into one send
+    uint8_t reply[MODBUS_TCP_MAX_ADU_LENGTH];
+    Clock::time_point now = rate_limit.enabled ? Clock::now() : Clock::time_point();
+    Source* source = rate_limit.enabled ? &sources[connection.source] : nullptr;
+    size_t pos = 0;
+    for (int frames = 0; frames < FRAMES_PER_TURN && connection.parked < MAX_PARKED_PER_CONNECTION &&
+                         size - pos >= MBAP_HEADER_LENGTH; ++frames) {
+        const uint8_t* frame = data + pos;
+        size_t frame_length = mbapFrameLength(frame);
+        if (frame_length == 0) {
+            std::cerr << "Malformed MBAP header, closing connection " << connection.id << std::endl;
+            closeConnection(connection);
+            return;
+        }
+        if (size - pos < frame_length) {
+            break;
+        }
+        pos += frame_length;
+
+        // Recorded before its fate is decided: a lost request was still sent, only its response is missing
+        recordRequest(connection.id, frame, frame_length);
+        Device* device = connection.device ? connection.device : deviceFor(frame[6]);
+        bool shed = source && !admit(&connection.bucket, *source, now);
+        Clock::duration latency{0};
+        Fate fate = shed ? Fate::Reply : decideFate(device, latency);
+        if (fate == Fate::Lose) {
+            continue;
+        }
+        if (fate == Fate::Disconnect) {
+            if (logEnabled(LogLevel::Info)) {
+                std::cout << "Simulated disconnect of connection " << connection.id << std::endl;
+            }
+            closeConnection(connection);
+            return;
+        }
+
+        size_t reply_length = processFrame(connection.id, device, shed, frame, frame_length, reply);
+        if (latency > Clock::duration::zero() || connection.parked > 0) {
+            parkReply(connection, latency, reply, reply_length); // Behind earlier parked replies, in order
+        } else {
+            if (!queueReply(connection, reply, reply_length)) {
+                return;
             }
         }
-        modbus_close(ctx);
     }
-    std::cout << "Modbus server thread stopped." << std::endl;
-}
\ No newline at end of file
+    if (data == connection.rx.data()) {
+        connection.rx.erase(connection.rx.begin(), connection.rx.begin() + static_cast<std::ptrdiff_t>(pos));
+        if (connection.rx.empty()) {
+            std::vector<uint8_t>().swap(connection.rx); // Idle connections hold no receive memory
+        }
+    } else if (pos < size) {
+        connection.rx.assign(data + pos, data + size);
+    }
+
+    if (!flush(connection)) {
+        closeConnection(connection);
+        return;
+    }
+    updateInterest(connection);
+}
+
+void ModbusServer::updateInterest(Connection& connection) {
+    const std::vector<uint8_t>& rx = connection.rx;
+    bool backlog = rx.size() >= MBAP_HEADER_LENGTH &&
+                   (mbapFrameLength(rx.data()) == 0 || rx.size() >= mbapFrameLength(rx.data()));
+    bool throttled = connection.parked >= MAX_PARKED_PER_CONNECTION;
+
+    // A client that is not reading gets no more requests served until its responses drain,
+    // and a connection with queued frames (or too many parked responses) is not read further
+    uint32_t events = 0;
+    if (connection.unsent() > 0) {
+        events = EPOLLOUT;
+    } else if (!backlog && !throttled) {
+        events = EPOLLIN;
+    }
+    if (events != connection.events) {
+        loop.modifyFd(connection.fd, events);
+        connection.events = events;
+    }
+
+    if (events == EPOLLOUT && !connection.stall_timer) {
+        connection.last_progress = Clock::now();
+        armStallTimer(connection);
+    } else if (events != EPOLLOUT && connection.stall_timer) {
+        loop.cancelTimer(connection.stall_timer);
+        connection.stall_timer = 0;
+    }
+
+    if (connection.unsent() == 0 && backlog && !throttled && !connection.resume_timer) {
+        // Queue another turn behind the connections that are already waiting
+        int fd = connection.fd;
+        uint32_t id = connection.id;
+        connection.resume_timer = loop.addTimer(Clock::now(), [this, fd, id] {
+            auto it = connections.find(fd);
+            if (it != connections.end() && it->second->id == id) {
+                it->second->resume_timer = 0;
+                Connection& resumed = *it->second;
+                serve(resumed, resumed.rx.data(), resumed.rx.size());
+            }
+        });
+    }
+}
+
+void ModbusServer::armStallTimer(Connection& connection) {
+    int fd = connection.fd;
+    uint32_t id = connection.id;
+    connection.stall_timer = loop.addTimer(connection.last_progress + SEND_STALL_TIMEOUT, [this, fd, id] {
+        auto it = connections.find(fd);
+        if (it == connections.end() || it->second->id != id) {
+            return;
+        }
+        Connection& stalled = *it->second;
+        stalled.stall_timer = 0;
+        if (Clock::now() - stalled.last_progress < SEND_STALL_TIMEOUT) {
+            armStallTimer(stalled); // The client read something meanwhile
+            return;
+        }
+        ++overflow_count;
+        std::cerr << "Connection " << stalled.id << " has not read its responses for "
+                  << std::chrono::duration_cast<std::chrono::seconds>(SEND_STALL_TIMEOUT).count()
+                  << " s, disconnecting" << std::endl;
+        closeConnection(stalled);
+    });
+}
+
+ModbusServer::Fate ModbusServer::decideFate(const Device* device, Clock::duration& latency) {
+    if (!device || !device->simulated_timing) {
+        return Fate::Reply;
+    }
+    const ResponseModelParams& model = device->response_model;
+    double roll = std::uniform_real_distribution<double>(0.0, 100.0)(random_engine);
+    if (roll < model.loss_percent) {
+        ++lost_count;
+        return Fate::Lose;
+    }
+    if (roll < model.loss_percent + model.disconnect_percent) {
+        ++disconnect_count;
+        return Fate::Disconnect;
+    }
+    latency = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(sampleLatencyMs(model, random_engine)));
+    return Fate::Reply;
+}
+
+void ModbusServer::park(Clock::time_point release, TimerWheel::Callback callback) {
+    response_wheel.schedule(release, std::move(callback));
+    if (!wheel_timer) {
+        armWheel();
+    }
+}
+
+void ModbusServer::armWheel() {
+    // One loop timer per wheel tick while responses are parked, however many there are
+    wheel_timer = loop.addTimer(response_wheel.nextTick(), [this] {
+        wheel_timer = 0;
+        response_wheel.advance(Clock::now());
+        if (!response_wheel.empty() && !wheel_timer) {
+            armWheel();
+        }
+    });
+}
+
+void ModbusServer::parkReply(Connection& connection, Clock::duration latency, const uint8_t* reply, size_t length) {
+    Clock::time_point release = std::max(Clock::now() + latency, connection.last_release);
+    connection.last_release = release;
+    ++connection.parked;
+
+    int fd = connection.fd;
+    uint32_t id = connection.id;
+    park(release, [this, fd, id, bytes = std::vector<uint8_t>(reply, reply + length)] {
+        auto it = connections.find(fd);
+        if (it == connections.end() || it->second->id != id) {
+            return; // The connection is gone
+        }
+        Connection& owner = *it->second;
+        --owner.parked;
+        if (!queueReply(owner, bytes.data(), bytes.size())) {
+            return;
+        }
+        if (!flush(owner)) {
+            closeConnection(owner);
+            return;
+        }
+        updateInterest(owner);
+    });
+}
+
+bool ModbusServer::queueReply(Connection& connection, const uint8_t* reply, size_t length) {
+    if (!connection.tx) {
+        connection.tx = output_pool.acquire();
+    } else if (connection.tx_end + length > OUTPUT_BUDGET && connection.tx_begin > 0) {
+        // Move the unsent tail to the front of the block
+        std::memmove(connection.tx, connection.tx + connection.tx_begin, connection.unsent());
+        connection.tx_end -= connection.tx_begin;
+        connection.tx_begin = 0;
+    }
+    if (connection.tx_end + length > OUTPUT_BUDGET) {
+        ++overflow_count;
+        std::cerr << "Connection " << connection.id << " is not reading its responses (" << connection.unsent()
+                  << " bytes unsent), disconnecting" << std::endl;
+        closeConnection(connection);
+        return false;
+    }
+    std::memcpy(connection.tx + connection.tx_end, reply, length);
+    connection.tx_end += static_cast<uint32_t>(length);
+    return true;
+}
+
+bool ModbusServer::flush(Connection& connection) {
+    while (connection.unsent() > 0) {
+        ssize_t n = send(connection.fd, connection.tx + connection.tx_begin, connection.unsent(), MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+            if (errno == EINTR) continue;
+            std::cerr << "Modbus reply failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        connection.tx_begin += static_cast<uint32_t>(n);
+    }
+    // Drained: the block goes back to the pool, so idle connections hold no output memory
+    if (connection.tx) {
+        output_pool.release(connection.tx);
+        connection.tx = nullptr;
+        connection.tx_begin = connection.tx_end = 0;
+    }
+    return true;
+}
+
+void ModbusServer::closeConnection(Connection& connection) {
+    int fd = connection.fd;
+    if (connection.resume_timer) {
+        loop.cancelTimer(connection.resume_timer);
+    }
+    if (connection.stall_timer) {
+        loop.cancelTimer(connection.stall_timer);
+    }
+    if (rate_limit.enabled) {
+        --sources[connection.source].connections; // The entry is pruned once idle
+    }
+    if (connection.tx) {
+        output_pool.release(connection.tx);
+    }
+    loop.removeFd(fd);
+    close(fd);
+    connections.erase(fd); // Destroys connection
+}
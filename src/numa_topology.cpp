@@ -0,0 +1,159 @@
+#include "numa_topology.hpp"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+    std::vector<int> allowedCpus() {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        return cpus;
+    }
+}
+
+std::vector<int> NumaTopology::parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) end = list.size();
+        std::string range = list.substr(pos, end - pos);
+        pos = end + 1;
+
+        char* rest = nullptr;
+        long first = std::strtol(range.c_str(), &rest, 10);
+        if (rest == range.c_str()) continue;
+        long last = *rest == '-' ? std::strtol(rest + 1, nullptr, 10) : first;
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    return cpus;
+}
+
+std::vector<NumaNode> NumaTopology::detect() {
+    // Only CPUs this process may use count: a cpuset or taskset can leave a node without any
+    std::vector<int> allowed = allowedCpus();
+    std::vector<NumaNode> nodes;
+    if (DIR* dir = opendir("/sys/devices/system/node")) {
+        while (dirent* entry = readdir(dir)) {
+            int id = 0;
+            if (std::strncmp(entry->d_name, "node", 4) != 0 || std::sscanf(entry->d_name + 4, "%d", &id) != 1) {
+                continue;
+            }
+            std::ifstream file(std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist");
+            std::string list;
+            std::getline(file, list);
+            NumaNode node{id, {}};
+            for (int cpu : parseCpuList(list)) {
+                if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                    node.cpus.push_back(cpu);
+                }
+            }
+            if (!node.cpus.empty()) {
+                nodes.push_back(std::move(node));
+            }
+        }
+        closedir(dir);
+    }
+    std::sort(nodes.begin(), nodes.end(), [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+    if (nodes.empty()) {
+        nodes.push_back(NumaNode{0, allowed});
+    }
+    return nodes;
+}
+
+std::vector<FleetShard> NumaTopology::partition(const std::vector<NumaNode>& nodes, size_t device_count) {
+    size_t total_cpus = 0;
+    for (const auto& node : nodes) {
+        total_cpus += node.cpus.size();
+    }
+    std::vector<FleetShard> shards;
+    size_t first = 0;
+    size_t cpus_before = 0;
+    for (const auto& node : nodes) {
+        cpus_before += node.cpus.size();
+        // Cumulative rounding, so the shard sizes always add up to device_count
+        size_t end = total_cpus ? device_count * cpus_before / total_cpus : device_count;
+        if (end > first) {
+            shards.push_back(FleetShard{node.id, ThreadPlacement{node.cpus}, first, end - first});
+        }
+        first = end;
+    }
+    return shards;
+}
+
+bool NumaTopology::bindCurrentThread(const std::vector<int>& cpus) {
+    if (cpus.empty()) return true;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (result != 0) {
+        std::cerr << "Failed to set CPU affinity: " << strerror(result) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool NumaTopology::placeCurrentThread(const ThreadPlacement& placement) {
+    bool placed = bindCurrentThread(placement.cpus);
+    if (placement.policy == SchedulingPolicy::Other) {
+        return placed;
+    }
+    sched_param param{};
+    param.sched_priority = placement.priority;
+    int policy = placement.policy == SchedulingPolicy::Fifo ? SCHED_FIFO : SCHED_RR;
+    int result = pthread_setschedparam(pthread_self(), policy, &param);
+    if (result != 0) {
+        static std::atomic<bool> warned{false};
+        if (!warned.exchange(true)) {
+            std::cerr << "Failed to set real-time scheduling: " << strerror(result)
+                      << " (needs CAP_SYS_NICE or an RLIMIT_RTPRIO of " << placement.priority << ")." << std::endl;
+        }
+        return false;
+    }
+    return placed;
+}
+
+std::vector<int> NumaTopology::restrictCpus(const std::vector<int>& node_cpus, const std::vector<int>& wanted) {
+    if (wanted.empty()) return node_cpus;
+    if (node_cpus.empty()) return wanted;
+    std::vector<int> common;
+    for (int cpu : wanted) {
+        if (std::find(node_cpus.begin(), node_cpus.end(), cpu) != node_cpus.end()) {
+            common.push_back(cpu);
+        }
+    }
+    if (common.empty()) {
+        std::cerr << "None of the configured CPUs is on this NUMA node; using them anyway." << std::endl;
+        return wanted;
+    }
+    return common;
+}
+
+void NumaTopology::runOn(const ThreadPlacement& placement, const std::function<void()>& task) {
+    std::thread worker([&] {
+        placeCurrentThread(placement);
+        task();
+    });
+    worker.join();
+}
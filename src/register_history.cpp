@@ -0,0 +1,179 @@
+#include "register_history.hpp"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+    int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+RegisterHistory::RegisterHistory(std::shared_ptr<SafeDataModel> model, size_t max_frames, size_t max_changes)
+    : data_model(model), base_generation(0), base_timestamp_ms(nowMs()), frames(std::max<size_t>(max_frames, 1)),
+      frame_head(0), frame_count(0), changes(std::max<size_t>(max_changes, 1)), change_head(0), change_tail(0),
+      last_generation(0) {
+
+    // Seed the base image with the full register image; everything later is deltas
+    base_addresses = data_model->getModbusAddresses();
+    base_values.resize(base_addresses.size());
+    base_generation = data_model->readRegisters(base_addresses, base_values.data());
+    last_generation = base_generation;
+}
+
+void RegisterHistory::record(uint64_t generation) {
+    // Fast path: the dirty set of exactly this tick. After a missed tick, diff against the last recorded one.
+    if (generation != last_generation + 1 || !data_model->getTickChanges(generation, scratch)) {
+        generation = data_model->changesSince(last_generation, scratch);
+    }
+    if (generation <= last_generation) return;
+
+    std::lock_guard<std::mutex> lock(history_mutex);
+    append(generation, nowMs(), scratch);
+    last_generation = generation;
+}
+
+void RegisterHistory::append(uint64_t generation, int64_t timestamp_ms, const std::vector<RegisterDelta>& tick_changes) {
+    if (tick_changes.size() > changes.size()) {
+        // A single tick larger than the whole ring: history restarts from this tick
+        while (frame_count > 0) {
+            evictOldest();
+        }
+        for (const auto& change : tick_changes) {
+            applyToBase(change);
+        }
+        base_generation = generation;
+        base_timestamp_ms = timestamp_ms;
+        return;
+    }
+
+    while (frame_count == frames.size() || change_tail - change_head + tick_changes.size() > changes.size()) {
+        evictOldest();
+    }
+
+    Frame& frame = frames[(frame_head + frame_count) % frames.size()];
+    frame.generation = generation;
+    frame.timestamp_ms = timestamp_ms;
+    frame.first_change = change_tail;
+    frame.count = static_cast<uint32_t>(tick_changes.size());
+    ++frame_count;
+
+    for (const auto& change : tick_changes) {
+        changes[change_tail % changes.size()] = change;
+        ++change_tail;
+    }
+}
+
+void RegisterHistory::evictOldest() {
+    const Frame& oldest = frames[frame_head];
+    for (uint32_t i = 0; i < oldest.count; ++i) {
+        applyToBase(changeAt(oldest.first_change + i));
+    }
+    base_generation = oldest.generation;
+    base_timestamp_ms = oldest.timestamp_ms;
+    change_head = oldest.first_change + oldest.count;
+    frame_head = (frame_head + 1) % frames.size();
+    --frame_count;
+}
+
+void RegisterHistory::applyToBase(const RegisterDelta& change) {
+    auto it = std::lower_bound(base_addresses.begin(), base_addresses.end(), change.address);
+    if (it != base_addresses.end() && *it == change.address) {
+        base_values[static_cast<size_t>(it - base_addresses.begin())] = change.value;
+    }
+}
+
+const RegisterHistory::Frame& RegisterHistory::frameAt(size_t index) const {
+    return frames[(frame_head + index) % frames.size()];
+}
+
+const RegisterDelta& RegisterHistory::changeAt(size_t index) const {
+    return changes[index % changes.size()];
+}
+
+bool RegisterHistory::lookup(uint16_t address, uint64_t generation, uint16_t& value) const {
+    uint64_t newest = frame_count > 0 ? frameAt(frame_count - 1).generation : base_generation;
+    if (generation < base_generation || generation > newest) {
+        return false;
+    }
+
+    // Walk back from the newest frame at or before the generation; the first hit is the value
+    for (size_t i = frame_count; i-- > 0;) {
+        const Frame& frame = frameAt(i);
+        if (frame.generation > generation) continue;
+        for (uint32_t j = frame.count; j-- > 0;) {
+            const RegisterDelta& change = changeAt(frame.first_change + j);
+            if (change.address == address) {
+                value = change.value;
+                return true;
+            }
+        }
+    }
+
+    auto it = std::lower_bound(base_addresses.begin(), base_addresses.end(), address);
+    if (it == base_addresses.end() || *it != address) {
+        return false;
+    }
+    value = base_values[static_cast<size_t>(it - base_addresses.begin())];
+    return true;
+}
+
+bool RegisterHistory::readAt(uint16_t address, uint64_t generation, uint16_t& value) {
+    std::lock_guard<std::mutex> lock(history_mutex);
+    return lookup(address, generation, value);
+}
+
+std::optional<uint64_t> RegisterHistory::generationAt(int64_t timestamp_ms) {
+    std::lock_guard<std::mutex> lock(history_mutex);
+    if (timestamp_ms < base_timestamp_ms) {
+        return std::nullopt;
+    }
+
+    // Frame timestamps are monotonic, so binary search the ring by logical index
+    size_t lo = 0;
+    size_t hi = frame_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (frameAt(mid).timestamp_ms <= timestamp_ms) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo == 0 ? base_generation : frameAt(lo - 1).generation;
+}
+
+bool RegisterHistory::readAtTime(uint16_t address, int64_t timestamp_ms, uint16_t& value) {
+    auto generation = generationAt(timestamp_ms);
+    return generation && readAt(address, *generation, value);
+}
+
+std::pair<uint64_t, uint64_t> RegisterHistory::retainedRange() {
+    std::lock_guard<std::mutex> lock(history_mutex);
+    uint64_t newest = frame_count > 0 ? frameAt(frame_count - 1).generation : base_generation;
+    return {base_generation, newest};
+}
+
+bool RegisterHistory::exportCsv(const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out) {
+        std::cerr << "Failed to open history export file: " << filename << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(history_mutex);
+    out << "generation,timestamp_ms,address,value\n";
+    for (size_t i = 0; i < base_addresses.size(); ++i) {
+        out << base_generation << ',' << base_timestamp_ms << ',' << base_addresses[i] << ',' << base_values[i] << '\n';
+    }
+    for (size_t i = 0; i < frame_count; ++i) {
+        const Frame& frame = frameAt(i);
+        for (uint32_t j = 0; j < frame.count; ++j) {
+            const RegisterDelta& change = changeAt(frame.first_change + j);
+            out << frame.generation << ',' << frame.timestamp_ms << ',' << change.address << ',' << change.value << '\n';
+        }
+    }
+    return static_cast<bool>(out);
+}
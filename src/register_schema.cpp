@@ -0,0 +1,83 @@
+#include "register_schema.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+RegisterSchema::RegisterSchema(const std::vector<Register>& registers) : address_index(65536, UNMAPPED) {
+    std::vector<const Register*> sorted;
+    sorted.reserve(registers.size());
+    for (const auto& reg : registers) {
+        sorted.push_back(&reg);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Register* a, const Register* b) {
+        return a->address < b->address;
+    });
+
+    layouts.reserve(sorted.size());
+    for (const Register* reg : sorted) {
+        size_t first_word = word_addresses.size();
+        if (first_word + reg->num_regs >= UNMAPPED) {
+            throw std::runtime_error("Register schema exceeds 65535 words");
+        }
+        RegisterLayout layout{reg->address, static_cast<uint16_t>(first_word), reg->type, reg->format, reg->access,
+                              static_cast<uint8_t>(reg->num_regs)};
+        layouts.push_back(layout);
+
+        // A register that starts right where the previous one ended extends the current span
+        if (!span_table.empty() &&
+            span_table.back().address + span_table.back().word_count == reg->address) {
+            span_table.back().word_count += reg->num_regs;
+        } else {
+            span_table.push_back(
+                {reg->address, static_cast<uint16_t>(first_word), static_cast<uint32_t>(reg->num_regs)});
+        }
+
+        initial_words.resize(first_word + reg->num_regs);
+        encodeValue(layout, reg->value, &initial_words[first_word]);
+        for (size_t w = 0; w < reg->num_regs; ++w) {
+            uint16_t address = static_cast<uint16_t>(reg->address + w);
+            address_index[address] = static_cast<uint16_t>(first_word + w);
+            word_addresses.push_back(address);
+            word_register.push_back(static_cast<uint16_t>(layouts.size() - 1));
+        }
+    }
+}
+
+const RegisterSpan* RegisterSchema::findSpan(uint16_t address) const {
+    auto it = std::upper_bound(span_table.begin(), span_table.end(), address,
+                               [](uint16_t a, const RegisterSpan& span) { return a < span.address; });
+    if (it == span_table.begin()) return nullptr;
+    --it;
+    return address < it->address + it->word_count ? &*it : nullptr;
+}
+
+const RegisterLayout* RegisterSchema::findRegister(uint16_t address) const {
+    uint16_t index = address_index[address];
+    if (index == UNMAPPED) return nullptr;
+    const RegisterLayout& layout = layouts[word_register[index]];
+    return layout.address == address ? &layout : nullptr;
+}
+
+void RegisterSchema::encodeValue(const RegisterLayout& layout, const RegisterValue& value, uint16_t* words) {
+    // Widen whatever alternative was passed; the register type decides the width on the wire
+    uint64_t raw = std::visit([](auto v) { return static_cast<uint64_t>(static_cast<int64_t>(v)); }, value);
+    for (int i = layout.num_regs - 1; i >= 0; --i) {
+        words[i] = static_cast<uint16_t>(raw & 0xFFFF);
+        raw >>= 16;
+    }
+}
+
+RegisterValue RegisterSchema::decodeValue(const RegisterLayout& layout, const uint16_t* words) {
+    uint64_t raw = 0;
+    for (int i = 0; i < layout.num_regs; ++i) {
+        raw = (raw << 16) | words[i];
+    }
+    switch (layout.type) {
+        case RegisterType::U16: return static_cast<uint16_t>(raw);
+        case RegisterType::S16: return static_cast<int16_t>(static_cast<uint16_t>(raw));
+        case RegisterType::U32: return static_cast<uint32_t>(raw);
+        case RegisterType::S32: return static_cast<int32_t>(static_cast<uint32_t>(raw));
+        case RegisterType::U64: return raw;
+        case RegisterType::S64: return static_cast<int64_t>(raw);
+    }
+    return raw;
+}
@@ -1,188 +1,216 @@
 #include "safe_data_model.hpp"
 #include <iostream>
+#include <algorithm>
 
-void SafeDataModel::initialize(const std::vector<Register>& initial_registers) {
+void SafeDataModel::initialize(std::shared_ptr<const RegisterSchema> register_schema, MemoryArena* arena) {
     std::lock_guard<std::mutex> lock(data_mutex);
+    schema = std::move(register_schema);
+    std::vector<uint16_t> initial_words = schema->initialWords();
+    size_t word_count = initial_words.size();
 
-    for (const auto& reg_template : initial_registers) {
-        logical_register_map[reg_template.address] = reg_template;
-
-        // Deconstruct the logical value into 16-bit Modbus registers
-        uint16_t start_addr = reg_template.address;
-        switch (reg_template.type) {
-            case RegisterType::U16:
-                modbus_register_map[start_addr] = std::get<uint16_t>(reg_template.value);
-                break;
-            case RegisterType::S16:
-                modbus_register_map[start_addr] = static_cast<uint16_t>(std::get<int16_t>(reg_template.value));
-                break;
-            case RegisterType::U32: {
-                uint32_t val = std::get<uint32_t>(reg_template.value);
-                modbus_register_map[start_addr] = (val >> 16) & 0xFFFF; // High word
-                modbus_register_map[start_addr + 1] = val & 0xFFFF; // Low word
-                break;
-            }
-            case RegisterType::S32: {
-                int32_t val = std::get<int32_t>(reg_template.value);
-                uint32_t uval = static_cast<uint32_t>(val);
-                modbus_register_map[start_addr] = (uval >> 16) & 0xFFFF; // High word
-                modbus_register_map[start_addr + 1] = uval & 0xFFFF; // Low word
-                break;
-            }
-            case RegisterType::U64: {
-                uint64_t val = std::get<uint64_t>(reg_template.value);
-                modbus_register_map[start_addr] = (val >> 48) & 0xFFFF;
-                modbus_register_map[start_addr + 1] = (val >> 32) & 0xFFFF;
-                modbus_register_map[start_addr + 2] = (val >> 16) & 0xFFFF;
-                modbus_register_map[start_addr + 3] = val & 0xFFFF;
-                break;
-            }
-            case RegisterType::S64: {
-                int64_t val = std::get<int64_t>(reg_template.value);
-                uint64_t uval = static_cast<uint64_t>(val);
-                modbus_register_map[start_addr] = (uval >> 48) & 0xFFFF;
-                modbus_register_map[start_addr + 1] = (uval >> 32) & 0xFFFF;
-                modbus_register_map[start_addr + 2] = (uval >> 16) & 0xFFFF;
-                modbus_register_map[start_addr + 3] = uval & 0xFFFF;
-                break;
-            }
-        }
-    }
+    // Arena memory is never given back, so every container is allocated once at its final size
+    words = ArenaVector<uint16_t>(initial_words.begin(), initial_words.end(), ArenaAllocator<uint16_t>(arena));
+
+    // The initial image is generation 1, so "changes since 0" yields every register
+    generation = 1;
+    block_versions = ArenaVector<uint64_t>((word_count + VERSION_BLOCK_WORDS - 1) / VERSION_BLOCK_WORDS, generation,
+                                           ArenaAllocator<uint64_t>(arena));
+    dirty_bitmap = ArenaVector<uint64_t>((word_count + 63) / 64, 0, ArenaAllocator<uint64_t>(arena));
+    dirty_words = ArenaVector<uint16_t>(ArenaAllocator<uint16_t>(arena));
+    dirty_words.reserve(word_count);
+    last_tick_changes = ArenaVector<RegisterDelta>(ArenaAllocator<RegisterDelta>(arena));
+    last_tick_changes.reserve(word_count);
 }
 
 bool SafeDataModel::getRegisterValue(uint16_t address, uint16_t& value) {
     std::lock_guard<std::mutex> lock(data_mutex);
-    auto it = modbus_register_map.find(address);
-    if (it != modbus_register_map.end()) {
-        value = it->second;
+    uint16_t index = schema->wordIndex(address);
+    if (index != RegisterSchema::UNMAPPED) {
+        value = words[index];
         return true;
     }
     return false;
 }
 
+bool SafeDataModel::readRange(uint16_t address, uint16_t count, uint16_t* values) {
+    std::lock_guard<std::mutex> lock(data_mutex);
+    const RegisterSpan* span = schema->findSpan(address);
+    if (!span || static_cast<uint32_t>(address) + count > span->address + span->word_count) {
+        return false;
+    }
+    std::copy_n(&words[span->first_word + (address - span->address)], count, values);
+    return true;
+}
+
 bool SafeDataModel::setRegisterValue(uint16_t address, uint16_t value) {
     std::lock_guard<std::mutex> lock(data_mutex);
 
     // Find which logical register this modbus register belongs to
-    uint16_t logical_addr = 0;
-    Register* logical_reg = nullptr;
-    for(auto& pair : logical_register_map) {
-        if(address >= pair.first && address < pair.first + pair.second.num_regs) {
-            logical_addr = pair.first;
-            logical_reg = &pair.second;
-            break;
+    uint16_t index = schema->wordIndex(address);
+    if (index == RegisterSchema::UNMAPPED) {
+        std::cerr << "Warning: Write to unmapped modbus address " << address << std::endl;
+        return false;
+    }
+
+    const RegisterLayout& logical_reg = schema->registerOfWord(index);
+    if (logical_reg.access == RegisterAccess::RO) {
+        std::cerr << "Warning: Denied write to RO logical register " << logical_reg.address << std::endl;
+        return false;
+    }
+
+    // The logical value is always derived from the words, so updating the word is enough
+    storeWord(index, value);
+    return true;
+}
+
+bool SafeDataModel::isWritableRange(uint16_t address, uint16_t count) const {
+    if (static_cast<uint32_t>(address) + count > 0x10000) {
+        return false;
+    }
+    for (uint16_t i = 0; i < count; ++i) {
+        uint16_t index = schema->wordIndex(static_cast<uint16_t>(address + i));
+        if (index == RegisterSchema::UNMAPPED || schema->registerOfWord(index).access == RegisterAccess::RO) {
+            return false;
         }
     }
+    return true;
+}
 
-    if (!logical_reg) {
-        std::cerr << "Warning: Write to unmapped modbus address " << address << std::endl;
+bool SafeDataModel::writeRange(uint16_t address, uint16_t count, const uint16_t* values) {
+    std::lock_guard<std::mutex> lock(data_mutex);
+
+    // Validate everything first so a rejected request leaves the model untouched
+    if (!isWritableRange(address, count)) {
         return false;
     }
+    for (uint16_t i = 0; i < count; ++i) {
+        storeWord(schema->wordIndex(static_cast<uint16_t>(address + i)), values[i]);
+    }
+    return true;
+}
 
-    if (logical_reg->access == RegisterAccess::RO) {
-        std::cerr << "Warning: Denied write to RO logical register " << logical_addr << std::endl;
+bool SafeDataModel::writeReadRange(uint16_t write_address, uint16_t write_count, const uint16_t* write_values,
+                                   uint16_t read_address, uint16_t read_count, uint16_t* read_values) {
+    std::lock_guard<std::mutex> lock(data_mutex);
+
+    // Validate everything first so a rejected request leaves the model untouched
+    const RegisterSpan* span = schema->findSpan(read_address);
+    if (!span || static_cast<uint32_t>(read_address) + read_count > span->address + span->word_count ||
+        !isWritableRange(write_address, write_count)) {
         return false;
     }
 
-    // Update the 16-bit register in the map
-    modbus_register_map[address] = value;
-
-    // Reconstruct the logical value from the updated 16-bit registers
-    switch(logical_reg->type) {
-        case RegisterType::U16:
-            logical_reg->value = value;
-            break;
-        case RegisterType::S16:
-            logical_reg->value = static_cast<int16_t>(value);
-            break;
-        case RegisterType::U32: {
-            uint32_t high = modbus_register_map[logical_addr];
-            uint32_t low = modbus_register_map[logical_addr + 1];
-            logical_reg->value = (high << 16) | low;
-            break;
-        }
-        case RegisterType::S32: {
-            uint32_t high = modbus_register_map[logical_addr];
-            uint32_t low = modbus_register_map[logical_addr + 1];
-            uint32_t uval = (high << 16) | low;
-            logical_reg->value = static_cast<int32_t>(uval);
-            break;
-        }
-        case RegisterType::U64: {
-            uint64_t val = 0;
-            val |= static_cast<uint64_t>(modbus_register_map[logical_addr]) << 48;
-            val |= static_cast<uint64_t>(modbus_register_map[logical_addr+1]) << 32;
-            val |= static_cast<uint64_t>(modbus_register_map[logical_addr+2]) << 16;
-            val |= static_cast<uint64_t>(modbus_register_map[logical_addr+3]);
-            logical_reg->value = val;
-            break;
-        }
-        case RegisterType::S64: {
-            uint64_t val = 0;
-            val |= static_cast<uint64_t>(modbus_register_map[logical_addr]) << 48;
-            val |= static_cast<uint64_t>(modbus_register_map[logical_addr+1]) << 32;
-            val |= static_cast<uint64_t>(modbus_register_map[logical_addr+2]) << 16;
-            val |= static_cast<uint64_t>(modbus_register_map[logical_addr+3]);
-            logical_reg->value = static_cast<int64_t>(val);
-            break;
-        }
+    for (uint16_t i = 0; i < write_count; ++i) {
+        storeWord(schema->wordIndex(static_cast<uint16_t>(write_address + i)), write_values[i]);
     }
+    std::copy_n(&words[span->first_word + (read_address - span->address)], read_count, read_values);
     return true;
 }
 
 std::optional<std::variant<uint16_t, int16_t, uint32_t, int32_t, uint64_t, int64_t>> SafeDataModel::getLogicalValue(uint16_t address) {
     std::lock_guard<std::mutex> lock(data_mutex);
-    auto it = logical_register_map.find(address);
-    if (it != logical_register_map.end()) {
-        return it->second.value;
+    const RegisterLayout* layout = schema->findRegister(address);
+    if (layout) {
+        return RegisterSchema::decodeValue(*layout, &words[layout->first_word]);
     }
     return std::nullopt;
 }
 
 void SafeDataModel::setLogicalValue(uint16_t address, const std::variant<uint16_t, int16_t, uint32_t, int32_t, uint64_t, int64_t>& value) {
     std::lock_guard<std::mutex> lock(data_mutex);
-    auto it = logical_register_map.find(address);
-    if (it != logical_register_map.end()) {
-        it->second.value = value;
-
+    const RegisterLayout* layout = schema->findRegister(address);
+    if (layout) {
         // Deconstruct and update the underlying 16-bit modbus registers
-        switch (it->second.type) {
-            case RegisterType::U16:
-                modbus_register_map[address] = std::get<uint16_t>(value);
-                break;
-            case RegisterType::S16:
-                modbus_register_map[address] = static_cast<uint16_t>(std::get<int16_t>(value));
-                break;
-            case RegisterType::U32: {
-                uint32_t val = std::get<uint32_t>(value);
-                modbus_register_map[address] = (val >> 16) & 0xFFFF;
-                modbus_register_map[address + 1] = val & 0xFFFF;
-                break;
-            }
-            case RegisterType::S32: {
-                int32_t val = std::get<int32_t>(value);
-                uint32_t uval = static_cast<uint32_t>(val);
-                modbus_register_map[address] = (uval >> 16) & 0xFFFF;
-                modbus_register_map[address + 1] = uval & 0xFFFF;
-                break;
-            }
-            case RegisterType::U64: {
-                uint64_t val = std::get<uint64_t>(value);
-                modbus_register_map[address] = (val >> 48) & 0xFFFF;
-                modbus_register_map[address + 1] = (val >> 32) & 0xFFFF;
-                modbus_register_map[address + 2] = (val >> 16) & 0xFFFF;
-                modbus_register_map[address + 3] = val & 0xFFFF;
-                break;
-            }
-            case RegisterType::S64: {
-                int64_t val = std::get<int64_t>(value);
-                uint64_t uval = static_cast<uint64_t>(val);
-                modbus_register_map[address] = (uval >> 48) & 0xFFFF;
-                modbus_register_map[address + 1] = (uval >> 32) & 0xFFFF;
-                modbus_register_map[address + 2] = (uval >> 16) & 0xFFFF;
-                modbus_register_map[address + 3] = uval & 0xFFFF;
-                break;
-            }
+        uint16_t encoded[4];
+        RegisterSchema::encodeValue(*layout, value, encoded);
+        for (uint16_t i = 0; i < layout->num_regs; ++i) {
+            storeWord(static_cast<uint16_t>(layout->first_word + i), encoded[i]);
+        }
+    }
+}
+
+void SafeDataModel::storeWord(uint16_t index, uint16_t value) {
+    uint16_t& word = words[index];
+    if (word == value) return;
+    word = value;
+
+    // Record each word once per tick, in the order it first changed
+    uint64_t bit = uint64_t{1} << (index & 63);
+    if (!(dirty_bitmap[index >> 6] & bit)) {
+        dirty_bitmap[index >> 6] |= bit;
+        dirty_words.push_back(index);
+    }
+}
+
+uint64_t SafeDataModel::commitTick() {
+    std::lock_guard<std::mutex> lock(data_mutex);
+    ++generation;
+
+    const std::vector<uint16_t>& addresses = schema->wordAddresses();
+    last_tick_changes.clear();
+    for (uint16_t index : dirty_words) {
+        dirty_bitmap[index >> 6] &= ~(uint64_t{1} << (index & 63));
+        block_versions[index / VERSION_BLOCK_WORDS] = generation;
+        last_tick_changes.push_back({addresses[index], words[index]});
+    }
+    dirty_words.clear();
+    return generation;
+}
+
+bool SafeDataModel::getTickChanges(uint64_t tick_generation, std::vector<RegisterDelta>& changes) {
+    std::lock_guard<std::mutex> lock(data_mutex);
+    if (tick_generation != generation) {
+        return false;
+    }
+    changes.assign(last_tick_changes.begin(), last_tick_changes.end());
+    return true;
+}
+
+uint64_t SafeDataModel::changesSince(uint64_t since, std::vector<RegisterDelta>& changes) {
+    std::lock_guard<std::mutex> lock(data_mutex);
+    changes.clear();
+
+    // Words are laid out in address order, so the output is sorted without a sort
+    const std::vector<uint16_t>& addresses = schema->wordAddresses();
+    for (size_t block = 0; block < block_versions.size(); ++block) {
+        if (block_versions[block] <= since) continue;
+        size_t end = std::min(words.size(), (block + 1) * VERSION_BLOCK_WORDS);
+        for (size_t index = block * VERSION_BLOCK_WORDS; index < end; ++index) {
+            changes.push_back({addresses[index], words[index]});
+        }
+    }
+    return generation;
+}
+
+uint64_t SafeDataModel::getGeneration() {
+    std::lock_guard<std::mutex> lock(data_mutex);
+    return generation;
+}
+
+std::vector<uint16_t> SafeDataModel::getModbusAddresses() {
+    std::lock_guard<std::mutex> lock(data_mutex);
+    return schema->wordAddresses();
+}
+
+uint64_t SafeDataModel::readRegisters(const std::vector<uint16_t>& addresses, uint16_t* values) {
+    std::lock_guard<std::mutex> lock(data_mutex);
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        uint16_t index = schema->wordIndex(addresses[i]);
+        values[i] = (index != RegisterSchema::UNMAPPED) ? words[index] : 0;
+    }
+    return generation;
+}
+
+uint64_t SafeDataModel::readLogicalValues(const std::vector<uint16_t>& addresses, int64_t* values) {
+    std::lock_guard<std::mutex> lock(data_mutex);
+    for (size_t i = 0; i < addresses.size(); ++i) {
+        const RegisterLayout* layout = schema->findRegister(addresses[i]);
+        if (!layout) {
+            values[i] = 0;
+            continue;
         }
+        RegisterValue value = RegisterSchema::decodeValue(*layout, &words[layout->first_word]);
+        values[i] = std::visit([](auto v) { return static_cast<int64_t>(v); }, value);
     }
+    return generation;
 }
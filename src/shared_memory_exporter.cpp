@@ -0,0 +1,88 @@
+#include "shared_memory_exporter.hpp"
+#include <iostream>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+SharedMemoryExporter::SharedMemoryExporter(std::shared_ptr<SafeDataModel> model, const DeviceIdentity& id)
+    : data_model(model), identity(id), header(nullptr), segment_size(0) {}
+
+SharedMemoryExporter::~SharedMemoryExporter() {
+    close();
+}
+
+bool SharedMemoryExporter::open(const std::string& n) {
+    if (header) return true;
+    name = n;
+
+    // The address layout is fixed once the data model has been initialized
+    addresses = data_model->getModbusAddresses();
+    staging.resize(addresses.size());
+    segment_size = SharedRegisterImageHeader::segmentSize(static_cast<uint32_t>(addresses.size()));
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd == -1) {
+        std::cerr << "Failed to open shared memory " << name << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(segment_size)) == -1) {
+        std::cerr << "Failed to size shared memory " << name << ": " << strerror(errno) << std::endl;
+        ::close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* mem = mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "Failed to map shared memory " << name << ": " << strerror(errno) << std::endl;
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    header = new (mem) SharedRegisterImageHeader;
+    header->magic = SharedRegisterImageHeader::MAGIC;
+    header->version = SharedRegisterImageHeader::VERSION;
+    header->header_size = sizeof(SharedRegisterImageHeader);
+    header->register_count = static_cast<uint32_t>(addresses.size());
+    header->unit_id = identity.unit_id;
+    header->serial_number = identity.serial_number;
+    header->reserved = 0;
+    header->sequence.store(0, std::memory_order_relaxed);
+    header->generation.store(0, std::memory_order_relaxed);
+    header->timestamp_ms.store(0, std::memory_order_relaxed);
+    std::memcpy(const_cast<uint16_t*>(header->addresses()), addresses.data(), addresses.size() * sizeof(uint16_t));
+
+    publish();
+    return true;
+}
+
+void SharedMemoryExporter::publish() {
+    if (!header) return;
+
+    // Take the model lock only for the copy into the private staging buffer
+    uint64_t generation = data_model->readRegisters(addresses, staging.data());
+    int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Seqlock write: odd sequence while the values are being replaced
+    uint64_t seq = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(const_cast<uint16_t*>(header->values()), staging.data(), staging.size() * sizeof(uint16_t));
+    header->generation.store(generation, std::memory_order_relaxed);
+    header->timestamp_ms.store(now_ms, std::memory_order_relaxed);
+
+    header->sequence.store(seq + 2, std::memory_order_release);
+}
+
+void SharedMemoryExporter::close() {
+    if (!header) return;
+    munmap(header, segment_size);
+    header = nullptr;
+    shm_unlink(name.c_str());
+}
@@ -1,68 +1,156 @@
 #include "simulation_engine.hpp"
+#include "log_level.hpp"
 #include <iostream>
 #include <chrono>
 #include <cmath>
 #include <ctime>
 #include <random>
 
-SimulationEngine::SimulationEngine(std::shared_ptr<SafeDataModel> model, const Config& cfg)
-    : data_model(model), config(cfg), running(false), current_state(DeviceState::OK), // Start in OK state
-      current_weather_model_index(0), last_weather_change_time(0), last_daily_reset_day(-1) {
+SimulationEngine::SimulationEngine(std::shared_ptr<SafeDataModel> model, std::shared_ptr<const Config> cfg,
+                                   size_t index)
+    : data_model(model), config(cfg), published_config(cfg), device_index(index), device(&cfg->devices[index]),
+      sim_params(&device->device_template->sim_params), current_state(DeviceState::OK), // Start in OK state
+      current_weather_model_index(0), last_weather_change_time(0), last_daily_reset_day(-1), connection_timer(0),
+      prev_temp(sim_params->ambient_temp_celsius), last_generation(0), sim_origin(time(0)),
+      real_origin(std::chrono::steady_clock::now()), clock_speed(1.0) {
     
     // Set static values from config
-    data_model->setLogicalValue(30003, config.identity.susy_id);
-    data_model->setLogicalValue(30005, config.identity.serial_number);
-    data_model->setLogicalValue(30051, config.identity.device_class);
-    data_model->setLogicalValue(30053, config.identity.susy_id);
-    data_model->setLogicalValue(30055, config.identity.manufacturer);
-    data_model->setLogicalValue(30057, config.identity.serial_number);
-    data_model->setLogicalValue(30059, config.identity.software_package);
-    data_model->setLogicalValue(30231, (uint32_t)config.sim_params.max_power_watts);
+    data_model->setLogicalValue(30003, device->identity.susy_id);
+    data_model->setLogicalValue(30005, device->identity.serial_number);
+    data_model->setLogicalValue(30051, device->identity.device_class);
+    data_model->setLogicalValue(30053, device->identity.susy_id);
+    data_model->setLogicalValue(30055, device->identity.manufacturer);
+    data_model->setLogicalValue(30057, device->identity.serial_number);
+    data_model->setLogicalValue(30059, device->identity.software_package);
+    data_model->setLogicalValue(30231, (uint32_t)device->max_power_watts);
     
     // Initialize random number generator
     std::random_device rd;
     rng.seed(rd());
     
     std::cout << "Inverter starting in operational state..." << std::endl;
-    std::cout << "Max Power: " << config.sim_params.max_power_watts << "W" << std::endl;
-    std::cout << "Ambient Temperature: " << config.sim_params.ambient_temp_celsius << "°C" << std::endl;
+    std::cout << "Max Power: " << device->max_power_watts << "W" << std::endl;
+    std::cout << "Ambient Temperature: " << sim_params->ambient_temp_celsius << "°C" << std::endl;
 }
 
-void SimulationEngine::start() {
-    if (running) return;
-    running = true;
-    simulation_thread = std::thread(&SimulationEngine::run, this);
+void SimulationEngine::addTickListener(std::function<void(uint64_t)> listener) {
+    tick_listeners.push_back(std::move(listener));
 }
 
-void SimulationEngine::stop() {
-    if (!running) return;
-    running = false;
-    if (simulation_thread.joinable()) {
-        simulation_thread.join();
+void SimulationEngine::post(std::function<void()> command) {
+    {
+        std::lock_guard<std::mutex> lock(command_mutex);
+        commands.push_back(std::move(command));
     }
+    command_notifier(this);
 }
 
-void SimulationEngine::run() {
-    std::cout << "Simulation thread started." << std::endl;
-    while (running) {
-        auto start_time = std::chrono::steady_clock::now();
+void SimulationEngine::setCommandNotifier(std::function<void(SimulationEngine*)> notifier) {
+    command_notifier = std::move(notifier);
+}
 
-        updateSimulationState();
+void SimulationEngine::runCommands() {
+    std::vector<std::function<void()>> batch;
+    {
+        std::lock_guard<std::mutex> lock(command_mutex);
+        batch.swap(commands);
+    }
+    for (auto& command : batch) {
+        command();
+    }
+}
 
-        auto end_time = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-        auto sleep_duration = std::chrono::milliseconds(config.sim_params.update_interval_ms) - elapsed;
+SimulationEngine::Status SimulationEngine::status() const {
+    static const char* const STATE_NAMES[] = {"off", "ok", "warning", "error"};
+    auto power = data_model->getLogicalValue(30775);
+    return {device,
+            STATE_NAMES[static_cast<int>(current_state)],
+            sim_params->weather_models[current_weather_model_index].name,
+            power ? std::visit([](auto value) { return static_cast<double>(value); }, *power) : 0.0,
+            prev_temp,
+            last_generation,
+            simulatedTime(),
+            clock_speed};
+}
 
-        if (sleep_duration.count() > 0) {
-            std::this_thread::sleep_for(sleep_duration);
+bool SimulationEngine::forceWeather(const std::string& name) {
+    for (size_t i = 0; i < sim_params->weather_models.size(); ++i) {
+        if (sim_params->weather_models[i].name == name) {
+            current_weather_model_index = static_cast<int>(i);
+            last_weather_change_time = simulatedTime();
+            return true;
         }
     }
-    std::cout << "Simulation thread stopped." << std::endl;
+    return false;
+}
+
+void SimulationEngine::forceFault(bool fault) {
+    current_state = fault ? DeviceState::ERROR : DeviceState::OK;
+}
+
+uint64_t SimulationEngine::snapshot(std::vector<uint16_t>& addresses, std::vector<int64_t>& values) const {
+    const auto& layouts = device->device_template->schema->registers();
+    addresses.clear();
+    addresses.reserve(layouts.size());
+    for (const auto& layout : layouts) {
+        addresses.push_back(layout.address);
+    }
+    values.resize(addresses.size());
+    return data_model->readLogicalValues(addresses, values.data());
+}
+
+void SimulationEngine::setClockSpeed(double speed) {
+    // Rebase so the simulated clock continues from where it is now
+    sim_origin = simulatedTime();
+    real_origin = std::chrono::steady_clock::now();
+    clock_speed = speed;
+}
+
+time_t SimulationEngine::simulatedTime() const {
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - real_origin).count();
+    return sim_origin + static_cast<time_t>(elapsed * clock_speed);
+}
+
+void SimulationEngine::reloadConfig(std::shared_ptr<const Config> new_config) {
+    std::atomic_store(&published_config, std::move(new_config));
+}
+
+void SimulationEngine::adoptPublishedConfig() {
+    std::shared_ptr<const Config> latest = std::atomic_load(&published_config);
+    if (latest == config) return;
+
+    // The previous Config is released once the last holder drops it
+    config = std::move(latest);
+    device = &config->devices[device_index];
+    sim_params = &device->device_template->sim_params;
+    if (current_weather_model_index >= static_cast<int>(sim_params->weather_models.size())) {
+        current_weather_model_index = 0;
+    }
+    data_model->setLogicalValue(30231, (uint32_t)device->max_power_watts);
+    std::cout << "Simulation parameters reloaded (max power " << device->max_power_watts << "W, fault rate "
+              << sim_params->fault_probability_percent << "%)" << std::endl;
+}
+
+void SimulationEngine::update() {
+    adoptPublishedConfig();
+    updateSimulationState();
+}
+
+void SimulationEngine::publish() {
+    last_generation = data_model->commitTick();
+    for (auto& listener : tick_listeners) {
+        listener(last_generation);
+    }
+}
+
+uint32_t SimulationEngine::updateIntervalMs() const {
+    return static_cast<uint32_t>(sim_params->update_interval_ms);
 }
 
 double SimulationEngine::calculatePowerOutput() {
-    time_t now = time(0);
-    struct tm *ltm = localtime(&now);
+    time_t now = simulatedTime();
+    struct tm local_time;
+    struct tm *ltm = localtime_r(&now, &local_time); // Engines tick concurrently on the scheduler's pool
 
     // Enhanced diurnal curve with seasonal variation
     double hour_of_day = ltm->tm_hour + ltm->tm_min / 60.0 + ltm->tm_sec / 3600.0;
@@ -82,57 +170,68 @@ double SimulationEngine::calculatePowerOutput() {
     // Improved solar curve - more realistic bell curve
     double day_length = sunset - sunrise;
     double noon = (sunrise + sunset) / 2.0;
-    double time_from_noon = hour_of_day - noon;
+
+    // Orientation: east-facing panels peak earlier, west-facing later, and both yield less than south
+    double azimuth_offset = (device->azimuth_degrees - 180.0) * M_PI / 180.0;
+    double peak_time = noon + (device->azimuth_degrees - 180.0) / 45.0;
+    double orientation_factor = 1.0 - 0.075 * (1.0 - cos(azimuth_offset));
+    double time_from_noon = hour_of_day - peak_time;
     double normalized_time = 2.0 * time_from_noon / day_length; // -1 to 1
     
     // Bell curve with sharper edges
     double solar_factor = exp(-2.0 * normalized_time * normalized_time);
     
     // Check for weather change
-    if (now - last_weather_change_time > config.sim_params.weather_change_interval_seconds) {
-        std::uniform_int_distribution<> dis(0, config.sim_params.weather_models.size() - 1);
+    if (now - last_weather_change_time > sim_params->weather_change_interval_seconds) {
+        std::uniform_int_distribution<> dis(0, sim_params->weather_models.size() - 1);
         current_weather_model_index = dis(rng);
         last_weather_change_time = now;
-        std::cout << "Weather changed to: " << config.sim_params.weather_models[current_weather_model_index].name << std::endl;
+        if (logEnabled(LogLevel::Info)) {
+            std::cout << "Weather changed to: " << sim_params->weather_models[current_weather_model_index].name << std::endl;
+        }
     }
 
-    double weather_multiplier = config.sim_params.weather_models[current_weather_model_index].power_multiplier;
+    double weather_multiplier = sim_params->weather_models[current_weather_model_index].power_multiplier;
     
     // Add some random variation (clouds, etc.)
     std::uniform_real_distribution<> variation_dis(0.9, 1.1);
     double random_variation = variation_dis(rng);
     
-    return config.sim_params.max_power_watts * solar_factor * seasonal_factor * weather_multiplier * random_variation;
+    return device->max_power_watts * solar_factor * seasonal_factor * orientation_factor * weather_multiplier *
+           random_variation;
 }
 
 double SimulationEngine::calculateGridVoltage(int phase) {
     // Simulate realistic grid voltage variations
-    std::uniform_real_distribution<> voltage_dis(-config.sim_params.voltage_variation_percent, 
-                                                  config.sim_params.voltage_variation_percent);
+    std::uniform_real_distribution<> voltage_dis(-sim_params->voltage_variation_percent, 
+                                                  sim_params->voltage_variation_percent);
     double variation = voltage_dis(rng) / 100.0;
     
     // Add phase offset for 3-phase system
     double phase_offset = phase * 120.0 * M_PI / 180.0; // 120° phase shift
-    double voltage_ripple = 0.005 * sin(time(0) * 2 * M_PI + phase_offset); // Small ripple
+    double voltage_ripple = 0.005 * sin(simulatedTime() * 2 * M_PI + phase_offset); // Small ripple
     
-    return config.sim_params.grid_voltage_nominal * (1.0 + variation + voltage_ripple);
+    return sim_params->grid_voltage_nominal * (1.0 + variation + voltage_ripple);
 }
 
 double SimulationEngine::calculateGridFrequency() {
-    std::uniform_real_distribution<> freq_dis(-config.sim_params.frequency_variation_hz, 
-                                              config.sim_params.frequency_variation_hz);
-    return config.sim_params.grid_frequency_nominal + freq_dis(rng);
+    std::uniform_real_distribution<> freq_dis(-sim_params->frequency_variation_hz, 
+                                              sim_params->frequency_variation_hz);
+    return sim_params->grid_frequency_nominal + freq_dis(rng);
 }
 
 void SimulationEngine::updateSimulationState() {
-    time_t current_time = time(0);
-    struct tm *ltm = localtime(&current_time);
+    time_t current_time = simulatedTime();
+    struct tm local_time;
+    struct tm *ltm = localtime_r(&current_time, &local_time);
     
     // Handle daily yield reset
-    if (last_daily_reset_day != ltm->tm_mday && ltm->tm_hour == config.sim_params.daily_yield_reset_hour) {
+    if (last_daily_reset_day != ltm->tm_mday && ltm->tm_hour == sim_params->daily_yield_reset_hour) {
         data_model->setLogicalValue(30517, (uint64_t)0); // Reset daily yield
         last_daily_reset_day = ltm->tm_mday;
-        std::cout << "Daily yield reset at midnight" << std::endl;
+        if (logEnabled(LogLevel::Info)) {
+            std::cout << "Daily yield reset at midnight" << std::endl;
+        }
     }
 
     // Check for client commands
@@ -146,20 +245,26 @@ void SimulationEngine::updateSimulationState() {
     if (ack_error == 26 && current_state == DeviceState::ERROR) {
         current_state = DeviceState::OK; // Resume operation after error ack
         data_model->setLogicalValue(40011, (uint32_t)0);
-        std::cout << "Error acknowledged, resuming operation" << std::endl;
+        if (logEnabled(LogLevel::Info)) {
+            std::cout << "Error acknowledged, resuming operation" << std::endl;
+        }
     } else if (op_state == 381) { // Stop command
         current_state = DeviceState::OFF;
-        std::cout << "Stop command received" << std::endl;
+        if (logEnabled(LogLevel::Info)) {
+            std::cout << "Stop command received" << std::endl;
+        }
     } else if (current_state != DeviceState::ERROR) {
         // Realistic fault injection based on temperature and power
         double current_power = calculatePowerOutput();
-        double power_ratio = current_power / config.sim_params.max_power_watts;
+        double power_ratio = current_power / device->max_power_watts;
         double temp_factor = 1.0 + power_ratio * 2.0; // Higher power = higher fault risk
         
         std::uniform_real_distribution<> fault_dis(0, 100);
-        if (fault_dis(rng) < config.sim_params.fault_probability_percent * temp_factor) {
+        if (fault_dis(rng) < sim_params->fault_probability_percent * temp_factor) {
             current_state = DeviceState::ERROR;
-            std::cout << "Random fault injected" << std::endl;
+            if (logEnabled(LogLevel::Info)) {
+                std::cout << "Random fault injected" << std::endl;
+            }
         } else if (op_state == 295) {
             current_state = DeviceState::OK;
         }
@@ -191,20 +296,20 @@ void SimulationEngine::updateSimulationState() {
     if (current_state == DeviceState::OK) {
         ac_power_total = calculatePowerOutput();
         if (ac_power_total > 50) { // Minimum power threshold for 2kW inverter
-            double efficiency = config.sim_params.efficiency_percent / 100.0;
+            double efficiency = sim_params->efficiency_percent / 100.0;
             dc_power_total = ac_power_total / efficiency;
             device_status_enum = 307; // OK
             detailed_op_status = 295; // MPP
             grid_contactor_enum = 51; // Closed
             
             // Calculate realistic power factor based on load
-            power_factor = 0.98 + 0.02 * (ac_power_total / config.sim_params.max_power_watts);
+            power_factor = 0.98 + 0.02 * (ac_power_total / device->max_power_watts);
             
             // Temperature-based derating
-            double power_ratio = ac_power_total / config.sim_params.max_power_watts;
-            double weather_temp_factor = config.sim_params.weather_models[current_weather_model_index].temp_increase_factor;
-            double internal_temp = config.sim_params.ambient_temp_celsius + 
-                                 (config.sim_params.max_internal_temp_celsius - config.sim_params.ambient_temp_celsius) * 
+            double power_ratio = ac_power_total / device->max_power_watts;
+            double weather_temp_factor = sim_params->weather_models[current_weather_model_index].temp_increase_factor;
+            double internal_temp = sim_params->ambient_temp_celsius + 
+                                 (sim_params->max_internal_temp_celsius - sim_params->ambient_temp_celsius) * 
                                  power_ratio * weather_temp_factor;
             
             if (internal_temp > 65.0) {
@@ -212,7 +317,9 @@ void SimulationEngine::updateSimulationState() {
                 double derating_factor = 1.0 - (internal_temp - 65.0) / 20.0; // Linear derating
                 ac_power_total *= std::max(0.5, derating_factor);
                 dc_power_total = ac_power_total / efficiency;
-                std::cout << "Temperature derating active: " << internal_temp << "°C" << std::endl;
+                if (logEnabled(LogLevel::Info)) {
+                    std::cout << "Temperature derating active: " << internal_temp << "°C" << std::endl;
+                }
             }
         } else {
             // Inverter is OK but no significant power (night/early morning)
@@ -224,7 +331,7 @@ void SimulationEngine::updateSimulationState() {
         device_status_enum = 35;   // Error
         detailed_op_status = 1392; // Error
         grid_contactor_enum = 311; // Open
-        event_number = 1001 + (rand() % 10); // Various error codes
+        event_number = 1001 + std::uniform_int_distribution<uint32_t>(0, 9)(rng); // Various error codes
     } else if (current_state == DeviceState::OFF) {
         device_status_enum = 303;  // Off
         detailed_op_status = 381;  // Stop
@@ -252,7 +359,7 @@ void SimulationEngine::updateSimulationState() {
     
     if (dc_power_1 > 0) {
         // Realistic I-V curve simulation for smaller inverter
-        double normalized_power = dc_power_1 / config.sim_params.max_power_watts;
+        double normalized_power = dc_power_1 / device->max_power_watts;
         dc_voltage_1 = 150.0 + normalized_power * 250.0; // 150V to 400V range for smaller inverter
         dc_current_1 = dc_power_1 / dc_voltage_1;
     }
@@ -274,7 +381,7 @@ void SimulationEngine::updateSimulationState() {
     uint32_t excitation_type = (reactive_power_total > 0) ? 1042 : 1041; // 1042=Lagging, 1041=Leading
     
     // Update energy accumulators
-    double seconds_per_tick = config.sim_params.update_interval_ms / 1000.0;
+    double seconds_per_tick = sim_params->update_interval_ms / 1000.0 * clock_speed; // Simulated seconds
     auto op_time_val = data_model->getLogicalValue(30521);
     uint64_t op_time = op_time_val ? std::get<uint64_t>(*op_time_val) : 0;
     op_time += static_cast<uint64_t>(seconds_per_tick);
@@ -298,7 +405,6 @@ void SimulationEngine::updateSimulationState() {
         daily_yield += static_cast<uint64_t>(energy_wh);
         
         // Realistic grid connection counting
-        static int connection_timer = 0;
         if (grid_contactor_enum == 51) {
             connection_timer++;
             if (connection_timer > 3600) { // Every hour of operation
@@ -309,14 +415,13 @@ void SimulationEngine::updateSimulationState() {
     }
     
     // Calculate temperature with environmental factors
-    double power_ratio = (ac_power_total > 0) ? (ac_power_total / config.sim_params.max_power_watts) : 0.0;
-    double weather_temp_factor = config.sim_params.weather_models[current_weather_model_index].temp_increase_factor;
-    double internal_temp = config.sim_params.ambient_temp_celsius + 
-                          (config.sim_params.max_internal_temp_celsius - config.sim_params.ambient_temp_celsius) * 
+    double power_ratio = (ac_power_total > 0) ? (ac_power_total / device->max_power_watts) : 0.0;
+    double weather_temp_factor = sim_params->weather_models[current_weather_model_index].temp_increase_factor;
+    double internal_temp = sim_params->ambient_temp_celsius + 
+                          (sim_params->max_internal_temp_celsius - sim_params->ambient_temp_celsius) * 
                           power_ratio * weather_temp_factor;
 
     // Add thermal inertia
-    static double prev_temp = config.sim_params.ambient_temp_celsius;
     internal_temp = prev_temp * 0.9 + internal_temp * 0.1; // Smooth temperature changes
     prev_temp = internal_temp;
     
@@ -0,0 +1,283 @@
+#include "sma_register_csv.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    constexpr size_t MAX_HEADER_SEARCH_ROWS = 20;
+
+    std::string_view trim(std::string_view s) {
+        while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+        while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+        return s;
+    }
+
+    bool equalsIgnoreCase(std::string_view a, std::string_view b) {
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+            return std::toupper(static_cast<unsigned char>(x)) == std::toupper(static_cast<unsigned char>(y));
+        });
+    }
+
+    bool containsIgnoreCase(std::string_view haystack, std::string_view needle) {
+        auto it = std::search(haystack.begin(), haystack.end(), needle.begin(), needle.end(), [](char x, char y) {
+            return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+        });
+        return it != haystack.end();
+    }
+
+    bool parseType(std::string_view s, RegisterType& type, size_t& num_regs) {
+        static const struct { const char* name; RegisterType type; size_t num_regs; } types[] = {
+            {"U16", RegisterType::U16, 1}, {"S16", RegisterType::S16, 1},
+            {"U32", RegisterType::U32, 2}, {"S32", RegisterType::S32, 2},
+            {"U64", RegisterType::U64, 4}, {"S64", RegisterType::S64, 4},
+        };
+        for (const auto& t : types) {
+            if (equalsIgnoreCase(s, t.name)) {
+                type = t.type;
+                num_regs = t.num_regs;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseFormat(std::string_view s, RegisterFormat& format) {
+        static const struct { const char* name; RegisterFormat format; } formats[] = {
+            {"RAW", RegisterFormat::RAW}, {"ENUM", RegisterFormat::ENUM}, {"TAGLIST", RegisterFormat::ENUM},
+            {"FIX0", RegisterFormat::FIX0}, {"FIX1", RegisterFormat::FIX1}, {"FIX2", RegisterFormat::FIX2},
+            {"FIX3", RegisterFormat::FIX3}, {"FIX4", RegisterFormat::FIX4}, {"DT", RegisterFormat::DT},
+            {"TM", RegisterFormat::DT}, {"FW", RegisterFormat::FW}, {"TEMP", RegisterFormat::TEMP},
+            {"Duration", RegisterFormat::Duration},
+        };
+        for (const auto& f : formats) {
+            if (equalsIgnoreCase(s, f.name)) {
+                format = f.format;
+                return true;
+            }
+        }
+        format = RegisterFormat::RAW;
+        return false;
+    }
+
+    RegisterAccess parseAccess(std::string_view s) {
+        if (equalsIgnoreCase(s, "RW") || equalsIgnoreCase(s, "R/W")) return RegisterAccess::RW;
+        if (equalsIgnoreCase(s, "WO") || equalsIgnoreCase(s, "W")) return RegisterAccess::WO;
+        return RegisterAccess::RO;
+    }
+
+    void setZeroValue(Register& reg) {
+        switch (reg.type) {
+            case RegisterType::U16: reg.value = static_cast<uint16_t>(0); break;
+            case RegisterType::S16: reg.value = static_cast<int16_t>(0); break;
+            case RegisterType::U32: reg.value = static_cast<uint32_t>(0); break;
+            case RegisterType::S32: reg.value = static_cast<int32_t>(0); break;
+            case RegisterType::U64: reg.value = static_cast<uint64_t>(0); break;
+            case RegisterType::S64: reg.value = static_cast<int64_t>(0); break;
+        }
+    }
+
+    struct Columns {
+        int address = -1;
+        int type = -1;
+        int format = -1;
+        int access = -1;
+        int unit = -1;
+        int description = -1;
+    };
+
+    bool findColumns(const std::vector<std::string_view>& header, Columns& columns) {
+        columns = Columns{};
+        for (size_t i = 0; i < header.size(); ++i) {
+            std::string_view name = trim(header[i]);
+            int index = static_cast<int>(i);
+            if (columns.address < 0 && (containsIgnoreCase(name, "addr") || containsIgnoreCase(name, "adr"))) {
+                columns.address = index;
+            } else if (columns.type < 0 && containsIgnoreCase(name, "typ")) {
+                columns.type = index;
+            } else if (columns.format < 0 && containsIgnoreCase(name, "format")) {
+                columns.format = index;
+            } else if (columns.access < 0 && containsIgnoreCase(name, "access")) {
+                columns.access = index;
+            } else if (columns.unit < 0 && containsIgnoreCase(name, "unit")) {
+                columns.unit = index;
+            } else if (columns.description < 0 &&
+                       (containsIgnoreCase(name, "descr") || containsIgnoreCase(name, "name"))) {
+                columns.description = index;
+            }
+        }
+        return columns.address >= 0 && columns.type >= 0;
+    }
+
+    std::string_view field(const std::vector<std::string_view>& fields, int index) {
+        return (index >= 0 && static_cast<size_t>(index) < fields.size()) ? trim(fields[index]) : std::string_view();
+    }
+}
+
+CsvReader::CsvReader(std::istream& stream, char delim) : in(stream), delimiter(delim), line_number(0) {}
+
+bool CsvReader::next(std::vector<std::string_view>& fields) {
+    while (std::getline(in, line)) {
+        ++line_number;
+        if (line_number == 1 && line.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            line.erase(0, 3);
+        }
+
+        if (delimiter == 0) {
+            // Spreadsheet exports use ';' or tabs depending on locale; pick the most frequent candidate
+            size_t commas = std::count(line.begin(), line.end(), ',');
+            size_t semicolons = std::count(line.begin(), line.end(), ';');
+            size_t tabs = std::count(line.begin(), line.end(), '\t');
+            delimiter = (semicolons >= commas && semicolons >= tabs) ? ';' : (tabs > commas ? '\t' : ',');
+        }
+
+        // Unescape in place: the write position never overtakes the read position
+        spans.clear();
+        size_t write = 0;
+        size_t field_start = 0;
+        bool quoted = false;
+        for (size_t i = 0;;) {
+            if (i == line.size()) {
+                if (!quoted || !std::getline(in, continuation)) break;
+                // A quoted field continues on the next physical line
+                ++line_number;
+                line += '\n';
+                line += continuation;
+                continue;
+            }
+            char c = line[i];
+            if (quoted) {
+                if (c == '"') {
+                    if (i + 1 < line.size() && line[i + 1] == '"') {
+                        line[write++] = '"';
+                        i += 2;
+                    } else {
+                        quoted = false;
+                        ++i;
+                    }
+                    continue;
+                }
+            } else if (c == '"') {
+                quoted = true;
+                ++i;
+                continue;
+            } else if (c == delimiter) {
+                spans.emplace_back(field_start, write - field_start);
+                field_start = write;
+                ++i;
+                continue;
+            } else if (c == '\r' && i + 1 == line.size()) {
+                ++i;
+                continue;
+            }
+            line[write++] = c;
+            ++i;
+        }
+        spans.emplace_back(field_start, write - field_start);
+
+        if (spans.size() == 1 && trim(std::string_view(line.data(), write)).empty()) {
+            continue;
+        }
+        fields.clear();
+        for (const auto& span : spans) {
+            fields.emplace_back(line.data() + span.first, span.second);
+        }
+        return true;
+    }
+    return false;
+}
+
+bool SmaRegisterCsv::read(std::istream& in, std::vector<SmaRegisterEntry>& entries, SmaImportStats& stats,
+                          std::string& error, bool with_text) {
+    CsvReader reader(in);
+    std::vector<std::string_view> fields;
+    Columns columns;
+
+    // Published lists may start with title rows; the header is the first row naming address and type columns
+    bool have_header = false;
+    for (size_t row = 0; row < MAX_HEADER_SEARCH_ROWS && reader.next(fields); ++row) {
+        if (findColumns(fields, columns)) {
+            have_header = true;
+            break;
+        }
+    }
+    if (!have_header) {
+        error = "no header row with address and type columns found";
+        return false;
+    }
+
+    entries.clear();
+    while (reader.next(fields)) {
+        ++stats.rows;
+        std::string_view address_text = field(fields, columns.address);
+        unsigned address = 0;
+        auto result = std::from_chars(address_text.data(), address_text.data() + address_text.size(), address);
+        if (result.ec != std::errc() || address > 0xFFFF) {
+            continue; // Section headings and notes between register rows
+        }
+
+        SmaRegisterEntry entry;
+        Register& reg = entry.reg;
+        reg.address = static_cast<uint16_t>(address);
+        if (!parseType(field(fields, columns.type), reg.type, reg.num_regs)) {
+            ++stats.unsupported_type;
+            continue;
+        }
+        if (!parseFormat(field(fields, columns.format), reg.format)) {
+            ++stats.unknown_format;
+        }
+        reg.access = parseAccess(field(fields, columns.access));
+        setZeroValue(reg);
+        if (with_text) {
+            entry.description = std::string(field(fields, columns.description));
+            entry.unit = std::string(field(fields, columns.unit));
+        }
+        entries.push_back(std::move(entry));
+    }
+
+    // Keep the first definition of every address range in file order; later overlapping rows are dropped
+    std::vector<bool> taken(65536, false);
+    size_t kept = 0;
+    for (auto& entry : entries) {
+        uint32_t end = static_cast<uint32_t>(entry.reg.address) + static_cast<uint32_t>(entry.reg.num_regs);
+        bool overlaps = end > 65536;
+        for (uint32_t word = entry.reg.address; !overlaps && word < end; ++word) {
+            overlaps = taken[word];
+        }
+        if (overlaps) {
+            ++stats.duplicates;
+            continue;
+        }
+        std::fill(taken.begin() + entry.reg.address, taken.begin() + end, true);
+        if (&entries[kept] != &entry) {
+            entries[kept] = std::move(entry);
+        }
+        ++kept;
+    }
+    entries.resize(kept);
+    std::sort(entries.begin(), entries.end(), [](const SmaRegisterEntry& a, const SmaRegisterEntry& b) {
+        return a.reg.address < b.reg.address;
+    });
+    stats.imported = kept;
+    return true;
+}
+
+std::vector<Register> SmaRegisterCsv::load(const std::string& filename, SmaImportStats& stats) {
+    std::ifstream in(filename);
+    if (!in) {
+        throw std::runtime_error("Cannot open register list: " + filename);
+    }
+    std::vector<SmaRegisterEntry> entries;
+    std::string error;
+    if (!read(in, entries, stats, error)) {
+        throw std::runtime_error("Cannot import register list " + filename + ": " + error);
+    }
+
+    std::vector<Register> registers;
+    registers.reserve(entries.size());
+    for (auto& entry : entries) {
+        registers.push_back(std::move(entry.reg));
+    }
+    return registers;
+}
@@ -0,0 +1,71 @@
+#include "timer_wheel.hpp"
+#include <algorithm>
+#include <iterator>
+
+TimerWheel::TimerWheel(Clock::duration tick_resolution, size_t slot_count)
+    : resolution(tick_resolution), origin(Clock::now()), current_tick(0), pending(0),
+      slots(std::max<size_t>(slot_count, 1)) {}
+
+void TimerWheel::schedule(Clock::time_point deadline, Callback callback) {
+    // Round up so an entry never runs before its deadline
+    uint64_t tick = current_tick + 1;
+    if (deadline > origin) {
+        tick = std::max(tick, static_cast<uint64_t>((deadline - origin + resolution - Clock::duration(1)) / resolution));
+    }
+    slots[tick % slots.size()].push_back({tick, std::move(callback)});
+    ++pending;
+}
+
+size_t TimerWheel::advance(Clock::time_point now) {
+    if (now <= origin) {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>((now - origin) / resolution);
+    if (target <= current_tick) {
+        return 0;
+    }
+
+    // After a long stall every slot is visited once; entries not yet due stay where they are
+    uint64_t steps = std::min<uint64_t>(target - current_tick, slots.size());
+    std::vector<Entry> due;
+    for (uint64_t step = 1; step <= steps; ++step) {
+        std::vector<Entry>& slot = slots[(current_tick + step) % slots.size()];
+        if (slot.empty()) continue;
+        auto later = std::stable_partition(slot.begin(), slot.end(), [target](const Entry& e) { return e.tick <= target; });
+        std::move(slot.begin(), later, std::back_inserter(due));
+        slot.erase(slot.begin(), later);
+    }
+
+    // Move time forward first, so callbacks that schedule again land in a future tick
+    current_tick = target;
+    pending -= due.size();
+    for (auto& entry : due) {
+        entry.callback();
+    }
+    return due.size();
+}
+
+TimerWheel::Clock::time_point TimerWheel::nextTick() const {
+    return origin + resolution * static_cast<int64_t>(current_tick + 1);
+}
+
+TimerWheel::Clock::time_point TimerWheel::nextDeadline() const {
+    if (pending == 0) {
+        return Clock::time_point::max();
+    }
+    // Every pending entry lies in the future, so the first slot holding an entry of this revolution has the earliest
+    for (uint64_t tick = current_tick + 1; tick <= current_tick + slots.size(); ++tick) {
+        for (const Entry& entry : slots[tick % slots.size()]) {
+            if (entry.tick == tick) {
+                return origin + resolution * static_cast<int64_t>(tick);
+            }
+        }
+    }
+    uint64_t earliest = UINT64_MAX;
+    for (const auto& slot : slots) {
+        for (const Entry& entry : slot) {
+            earliest = std::min(earliest, entry.tick);
+        }
+    }
+    return origin + resolution * static_cast<int64_t>(earliest);
+}
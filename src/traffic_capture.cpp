@@ -0,0 +1,116 @@
+#include "traffic_capture.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using capture::CaptureFileHeader;
+using capture::CaptureRecordHeader;
+
+TrafficCapture::TrafficCapture() : header(nullptr), ring(nullptr), mapping_size(0) {}
+
+TrafficCapture::~TrafficCapture() {
+    close();
+}
+
+bool TrafficCapture::open(const std::string& filename, size_t capacity_bytes) {
+    if (header) return true;
+
+    // Keep the ring 8-byte aligned and large enough for a few maximum-size frames
+    size_t capacity = std::max<size_t>(capacity_bytes, 64 * 1024) & ~size_t{7};
+    mapping_size = sizeof(CaptureFileHeader) + capacity;
+
+    int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        std::cerr << "Failed to open capture file " << filename << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(mapping_size)) == -1) {
+        std::cerr << "Failed to size capture file " << filename << ": " << strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+    void* mem = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mem == MAP_FAILED) {
+        std::cerr << "Failed to map capture file " << filename << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    header = static_cast<CaptureFileHeader*>(mem);
+    ring = static_cast<uint8_t*>(mem) + sizeof(CaptureFileHeader);
+    header->magic = capture::FILE_MAGIC;
+    header->version = capture::FORMAT_VERSION;
+    header->capacity = capacity;
+    header->head = 0;
+    header->tail = 0;
+    header->record_count = 0;
+    header->dropped_count = 0;
+    return true;
+}
+
+void TrafficCapture::record(uint32_t connection_id, capture::Direction direction, const uint8_t* frame, size_t length) {
+    if (!header) return;
+
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    std::lock_guard<std::mutex> lock(capture_mutex);
+    const uint64_t capacity = header->capacity;
+    const uint32_t size = capture::recordSize(length);
+    if (size > capacity / 2) return;
+
+    // Records are never split; skip the remainder of the ring if this one does not fit
+    uint64_t pos = header->head % capacity;
+    uint64_t skip = (capacity - pos < size) ? capacity - pos : 0;
+
+    // Evict the oldest records until the skipped tail and the new record fit
+    while (header->head + skip + size - header->tail > capacity) {
+        uint64_t tail_pos = header->tail % capacity;
+        if (capacity - tail_pos < sizeof(CaptureRecordHeader)) {
+            header->tail += capacity - tail_pos;
+            continue;
+        }
+        const auto* oldest = reinterpret_cast<const CaptureRecordHeader*>(ring + tail_pos);
+        if (oldest->direction != static_cast<uint8_t>(capture::Direction::Padding)) {
+            ++header->dropped_count;
+        }
+        header->tail += oldest->record_size;
+    }
+
+    if (skip > 0) {
+        if (skip >= sizeof(CaptureRecordHeader)) {
+            auto* padding = reinterpret_cast<CaptureRecordHeader*>(ring + pos);
+            std::memset(padding, 0, sizeof(*padding));
+            padding->record_size = static_cast<uint32_t>(skip);
+            padding->direction = static_cast<uint8_t>(capture::Direction::Padding);
+        }
+        header->head += skip;
+        pos = 0;
+    }
+
+    auto* record = reinterpret_cast<CaptureRecordHeader*>(ring + pos);
+    record->record_size = size;
+    record->connection_id = connection_id;
+    record->timestamp_ns = static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    record->direction = static_cast<uint8_t>(direction);
+    record->reserved = 0;
+    record->frame_length = static_cast<uint16_t>(length);
+    record->reserved2 = 0;
+    std::memcpy(record + 1, frame, length);
+
+    header->head += size;
+    ++header->record_count;
+}
+
+void TrafficCapture::close() {
+    if (!header) return;
+    msync(header, mapping_size, MS_SYNC);
+    munmap(header, mapping_size);
+    header = nullptr;
+    ring = nullptr;
+}
@@ -0,0 +1,102 @@
+#include "work_stealing_pool.hpp"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(size_t thread_count, ThreadPlacement placement)
+    : worker_placement(std::move(placement)), task(nullptr), batch(0), stopping(false), remaining(0), steal_count(0) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (size_t i = 1; i < thread_count; ++i) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex);
+        stopping = true;
+    }
+    batch_ready.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::parallelFor(size_t count, const std::function<void(size_t)>& batch_task) {
+    if (count == 0) return;
+    task = &batch_task;
+    remaining = count;
+
+    // Contiguous blocks keep neighbouring indices on one thread
+    size_t threads = queues.size();
+    for (size_t t = 0; t < threads; ++t) {
+        std::lock_guard<std::mutex> lock(queues[t]->mutex);
+        for (size_t i = count * t / threads; i < count * (t + 1) / threads; ++i) {
+            queues[t]->tasks.push_back(i);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(batch_mutex);
+        ++batch;
+    }
+    batch_ready.notify_all();
+
+    while (runOne(0)) {
+    }
+    std::unique_lock<std::mutex> lock(batch_mutex);
+    batch_done.wait(lock, [this] { return remaining.load() == 0; });
+    task = nullptr;
+}
+
+void WorkStealingPool::workerLoop(size_t self) {
+    NumaTopology::placeCurrentThread(worker_placement);
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(batch_mutex);
+            batch_ready.wait(lock, [this, seen] { return stopping || batch != seen; });
+            if (stopping) return;
+            seen = batch;
+        }
+        while (runOne(self)) {
+        }
+    }
+}
+
+bool WorkStealingPool::runOne(size_t self) {
+    size_t index = 0;
+    bool found = false;
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            index = own.tasks.front();
+            own.tasks.pop_front();
+            found = true;
+        }
+    }
+    // Steal from the far end of another queue, away from where its owner is working
+    for (size_t offset = 1; !found && offset < queues.size(); ++offset) {
+        Queue& victim = *queues[(self + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            index = victim.tasks.back();
+            victim.tasks.pop_back();
+            found = true;
+            steal_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    if (!found) {
+        return false;
+    }
+
+    (*task)(index);
+    if (remaining.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(batch_mutex);
+        batch_done.notify_all();
+    }
+    return true;
+}
@@ -0,0 +1,163 @@
+#include "columnar_format.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <limits>
+#include <cstring>
+
+/**
+ * @brief Prints a columnar export file as CSV.
+ *
+ * Usage: columnar_reader <file> [--from <ms>] [--to <ms>] [--info]
+ *
+ * Blocks entirely outside the requested time window are skipped using their
+ * headers, without decoding any column data. --info prints one line per
+ * section and block instead of the rows.
+ */
+
+namespace {
+    void usage(const char* program) {
+        std::cerr << "Usage: " << program << " <file> [--from <ms>] [--to <ms>] [--info]" << std::endl;
+    }
+
+    template<typename T>
+    bool readStruct(std::ifstream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string filename = argv[1];
+    int64_t from_ms = std::numeric_limits<int64_t>::min();
+    int64_t to_ms = std::numeric_limits<int64_t>::max();
+    bool info_only = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--from" && i + 1 < argc) {
+            from_ms = std::stoll(argv[++i]);
+        } else if (arg == "--to" && i + 1 < argc) {
+            to_ms = std::stoll(argv[++i]);
+        } else if (arg == "--info") {
+            info_only = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << filename << std::endl;
+        return 1;
+    }
+
+    std::vector<columnar::ColumnarColumnInfo> columns;
+    std::vector<uint32_t> column_bytes;
+    std::vector<uint8_t> payload;
+    std::vector<std::vector<int64_t>> values;
+
+    uint32_t magic;
+    while (in.read(reinterpret_cast<char*>(&magic), sizeof(magic))) {
+        in.seekg(-static_cast<std::streamoff>(sizeof(magic)), std::ios::cur);
+
+        if (magic == columnar::FILE_MAGIC) {
+            // A new section: the writer was (re)started
+            columnar::ColumnarFileHeader header;
+            if (!readStruct(in, header) || header.version != columnar::FORMAT_VERSION) {
+                std::cerr << "Unsupported or truncated file header" << std::endl;
+                return 1;
+            }
+            columns.resize(header.column_count);
+            in.read(reinterpret_cast<char*>(columns.data()), columns.size() * sizeof(columnar::ColumnarColumnInfo));
+            if (!in) {
+                std::cerr << "Truncated column table" << std::endl;
+                return 1;
+            }
+            // Every section starts with the generation and timestamp columns
+            if (columns.size() < 2) {
+                std::cerr << "Corrupt file: " << columns.size() << " column(s), expected at least 2" << std::endl;
+                return 1;
+            }
+
+            if (info_only) {
+                std::cout << "section unit_id=" << header.unit_id << " serial=" << header.serial_number
+                          << " interval_ms=" << header.interval_ms << " columns=" << header.column_count << std::endl;
+            } else {
+                std::cout << "generation,timestamp_ms";
+                for (size_t c = 2; c < columns.size(); ++c) {
+                    std::cout << ',' << columns[c].address;
+                }
+                std::cout << std::endl;
+            }
+            continue;
+        }
+
+        if (magic != columnar::BLOCK_MAGIC || columns.empty()) {
+            std::cerr << "Corrupt file: unexpected magic 0x" << std::hex << magic << std::dec << std::endl;
+            return 1;
+        }
+
+        columnar::ColumnarBlockHeader block;
+        if (!readStruct(in, block)) {
+            break;
+        }
+        if (block.last_timestamp_ms < from_ms || block.first_timestamp_ms > to_ms) {
+            in.seekg(static_cast<std::streamoff>(block.payload_bytes), std::ios::cur);
+            continue;
+        }
+        if (info_only) {
+            std::cout << "block rows=" << block.row_count << " first_generation=" << block.first_generation
+                      << " first_ms=" << block.first_timestamp_ms << " last_ms=" << block.last_timestamp_ms
+                      << " bytes=" << block.payload_bytes << std::endl;
+            in.seekg(static_cast<std::streamoff>(block.payload_bytes), std::ios::cur);
+            continue;
+        }
+
+        payload.resize(block.payload_bytes);
+        if (!in.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size()))) {
+            std::cerr << "Truncated block" << std::endl;
+            return 1;
+        }
+
+        if (payload.size() < columns.size() * sizeof(uint32_t)) {
+            std::cerr << "Corrupt block at generation " << block.first_generation << ": too short for its column sizes"
+                      << std::endl;
+            return 1;
+        }
+        column_bytes.resize(columns.size());
+        std::memcpy(column_bytes.data(), payload.data(), columns.size() * sizeof(uint32_t));
+        const uint8_t* pos = payload.data() + columns.size() * sizeof(uint32_t);
+        const uint8_t* end = payload.data() + payload.size();
+
+        values.resize(columns.size());
+        for (size_t c = 0; c < columns.size(); ++c) {
+            if (column_bytes[c] > static_cast<size_t>(end - pos) ||
+                !columnar::decodeColumn(
+                    pos,
+                    pos + column_bytes[c],
+                    static_cast<columnar::ColumnEncoding>(columns[c].encoding),
+                    block.row_count,
+                    values[c])) {
+                std::cerr << "Corrupt column " << c << " in block at generation " << block.first_generation << std::endl;
+                return 1;
+            }
+            pos += column_bytes[c];
+        }
+
+        for (uint32_t r = 0; r < block.row_count; ++r) {
+            if (values[1][r] < from_ms || values[1][r] > to_ms) continue;
+            std::cout << values[0][r];
+            for (size_t c = 1; c < columns.size(); ++c) {
+                std::cout << ',' << values[c][r];
+            }
+            std::cout << '\n';
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include "traffic_capture_format.hpp"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * @brief Replays a Modbus capture recorded by the simulator against a server.
+ *
+ * Usage: modbus_replay <capture_file> [--host <ip>] [--port <port>] [--udp | --unix <path>] [--fast]
+ *                      [--speed <factor>]
+ *
+ * Every captured client connection gets its own TCP (or Unix socket / UDP)
+ * connection, so the same capture can benchmark each transport. Requests are
+ * re-issued in capture order, at the original pacing (scaled by --speed) or
+ * back to back with --fast, and each response is checked against the captured
+ * one for a matching function code (normal vs. exception). A latency summary
+ * is printed at the end.
+ */
+
+namespace {
+    struct ReplayRequest {
+        uint32_t connection_id;
+        int64_t timestamp_ns;
+        std::vector<uint8_t> frame;
+        int expected_function_code; // -1 if no response was captured
+    };
+
+    void usage(const char* program) {
+        std::cerr << "Usage: " << program
+                  << " <capture_file> [--host <ip>] [--port <port>] [--udp | --unix <path>] [--fast]"
+                     " [--speed <factor>]" << std::endl;
+    }
+
+    bool readExact(int fd, uint8_t* buffer, size_t length) {
+        size_t received = 0;
+        while (received < length) {
+            ssize_t n = recv(fd, buffer + received, length - received, 0);
+            if (n <= 0) {
+                return false;
+            }
+            received += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    enum class Transport { TCP, UDP, UNIX };
+
+    int connectTo(Transport transport, const std::string& host, int port, const std::string& socket_path) {
+        int fd;
+        if (transport == Transport::UNIX) {
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            sockaddr_un addr{};
+            addr.sun_family = AF_UNIX;
+            std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+            if (fd == -1 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+                if (fd != -1) close(fd);
+                return -1;
+            }
+        } else {
+            fd = socket(AF_INET, transport == Transport::UDP ? SOCK_DGRAM : SOCK_STREAM, 0);
+            if (fd == -1) {
+                return -1;
+            }
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(static_cast<uint16_t>(port));
+            if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1 ||
+                connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == -1) {
+                close(fd);
+                return -1;
+            }
+            if (transport == Transport::TCP) {
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            }
+        }
+        timeval timeout{2, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return fd;
+    }
+
+    /// Receives one MBAP response: a whole datagram for UDP, header then body for streams.
+    bool receiveResponse(Transport transport, int fd, uint8_t* response, size_t capacity) {
+        if (transport == Transport::UDP) {
+            ssize_t n = recv(fd, response, capacity, 0);
+            return n > 7 && static_cast<size_t>(n) == 6 + static_cast<size_t>((response[4] << 8) | response[5]);
+        }
+        if (!readExact(fd, response, 7)) {
+            return false;
+        }
+        size_t length = static_cast<size_t>((response[4] << 8) | response[5]);
+        return length >= 2 && length <= capacity - 6 && readExact(fd, response + 7, length - 1);
+    }
+
+    /// Walks the retained part of the ring and collects requests with their captured response codes.
+    bool loadCapture(const std::string& filename, std::vector<ReplayRequest>& requests) {
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd == -1) {
+            std::cerr << "Cannot open " << filename << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == -1 || static_cast<size_t>(st.st_size) < sizeof(capture::CaptureFileHeader)) {
+            std::cerr << "Not a capture file: " << filename << std::endl;
+            close(fd);
+            return false;
+        }
+        void* mem = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mem == MAP_FAILED) {
+            std::cerr << "Cannot map " << filename << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        const auto* header = static_cast<const capture::CaptureFileHeader*>(mem);
+        const uint8_t* ring = static_cast<const uint8_t*>(mem) + sizeof(capture::CaptureFileHeader);
+        if (header->magic != capture::FILE_MAGIC || header->version != capture::FORMAT_VERSION ||
+            sizeof(capture::CaptureFileHeader) + header->capacity > static_cast<size_t>(st.st_size)) {
+            std::cerr << "Unsupported capture file: " << filename << std::endl;
+            munmap(mem, static_cast<size_t>(st.st_size));
+            return false;
+        }
+
+        // Connection -> indexes of its requests awaiting a response, oldest first (clients may pipeline)
+        std::unordered_map<uint32_t, std::deque<size_t>> pending;
+        const uint64_t capacity = header->capacity;
+        uint64_t offset = header->tail;
+        while (offset < header->head) {
+            uint64_t pos = offset % capacity;
+            if (capacity - pos < sizeof(capture::CaptureRecordHeader)) {
+                offset += capacity - pos;
+                continue;
+            }
+            const auto* record = reinterpret_cast<const capture::CaptureRecordHeader*>(ring + pos);
+            if (record->record_size == 0) break;
+            if (record->record_size > capacity - pos ||
+                sizeof(capture::CaptureRecordHeader) + record->frame_length > record->record_size) {
+                std::cerr << "Corrupt capture file: bad record at offset " << offset << std::endl;
+                munmap(mem, static_cast<size_t>(st.st_size));
+                return false;
+            }
+            offset += record->record_size;
+
+            const uint8_t* frame = reinterpret_cast<const uint8_t*>(record + 1);
+            if (record->direction == static_cast<uint8_t>(capture::Direction::Request)) {
+                pending[record->connection_id].push_back(requests.size());
+                requests.push_back({
+                    record->connection_id,
+                    record->timestamp_ns,
+                    std::vector<uint8_t>(frame, frame + record->frame_length),
+                    -1});
+            } else if (record->direction == static_cast<uint8_t>(capture::Direction::Response)) {
+                auto it = pending.find(record->connection_id);
+                if (it != pending.end() && !it->second.empty()) {
+                    size_t index = it->second.front();
+                    it->second.pop_front();
+                    if (record->frame_length > 7) {
+                        requests[index].expected_function_code = frame[7];
+                    }
+                }
+            }
+        }
+        std::cout << "Loaded " << requests.size() << " requests (" << header->record_count << " records captured, "
+                  << header->dropped_count << " overwritten)" << std::endl;
+        munmap(mem, static_cast<size_t>(st.st_size));
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string filename = argv[1];
+    std::string host = "127.0.0.1";
+    int port = 1502;
+    Transport transport = Transport::TCP;
+    std::string socket_path;
+    bool fast = false;
+    double speed = 1.0;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--host" && i + 1 < argc) {
+            host = argv[++i];
+        } else if (arg == "--port" && i + 1 < argc) {
+            port = std::stoi(argv[++i]);
+        } else if (arg == "--udp") {
+            transport = Transport::UDP;
+        } else if (arg == "--unix" && i + 1 < argc) {
+            transport = Transport::UNIX;
+            socket_path = argv[++i];
+        } else if (arg == "--fast") {
+            fast = true;
+        } else if (arg == "--speed" && i + 1 < argc) {
+            speed = std::max(1e-6, std::stod(argv[++i]));
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<ReplayRequest> requests;
+    if (!loadCapture(filename, requests)) {
+        return 1;
+    }
+    if (requests.empty()) {
+        return 0;
+    }
+
+    std::unordered_map<uint32_t, int> connections;
+    std::vector<double> latencies_us;
+    latencies_us.reserve(requests.size());
+    size_t failures = 0;
+    size_t mismatches = 0;
+    uint8_t response[260];
+
+    auto replay_start = std::chrono::steady_clock::now();
+    const int64_t capture_start_ns = requests.front().timestamp_ns;
+    for (const auto& request : requests) {
+        if (!fast) {
+            auto offset = std::chrono::nanoseconds(
+                static_cast<int64_t>(static_cast<double>(request.timestamp_ns - capture_start_ns) / speed));
+            std::this_thread::sleep_until(replay_start + offset);
+        }
+
+        int& fd = connections[request.connection_id];
+        if (fd <= 0) {
+            fd = connectTo(transport, host, port, socket_path);
+            if (fd == -1) {
+                std::string target = transport == Transport::UNIX ? socket_path : host + ":" + std::to_string(port);
+                std::cerr << "Cannot connect to " << target << ": " << strerror(errno) << std::endl;
+                return 1;
+            }
+        }
+
+        auto sent_at = std::chrono::steady_clock::now();
+        if (send(fd, request.frame.data(), request.frame.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(request.frame.size()) ||
+            !receiveResponse(transport, fd, response, sizeof(response))) {
+            ++failures;
+            close(fd);
+            fd = 0;
+            continue;
+        }
+        latencies_us.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent_at).count());
+        if (request.expected_function_code >= 0 && response[7] != request.expected_function_code) {
+            ++mismatches;
+        }
+    }
+
+    for (auto& connection : connections) {
+        if (connection.second > 0) {
+            close(connection.second);
+        }
+    }
+
+    double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - replay_start).count();
+    std::cout << "Replayed " << requests.size() << " requests over " << connections.size() << " connections in "
+              << elapsed_s << " s (" << failures << " failed, " << mismatches << " response mismatches)" << std::endl;
+    if (!latencies_us.empty()) {
+        std::sort(latencies_us.begin(), latencies_us.end());
+        auto percentile = [&](double p) {
+            return latencies_us[static_cast<size_t>(p * static_cast<double>(latencies_us.size() - 1))];
+        };
+        std::cout << "Latency us: min " << latencies_us.front() << ", p50 " << percentile(0.5) << ", p99 "
+                  << percentile(0.99) << ", max " << latencies_us.back() << std::endl;
+    }
+    return failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,107 @@
+#include "sma_register_csv.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Converts an SMA Modbus register list (CSV) into the profile's register section.
+ *
+ * Usage: sma_register_import <register_list.csv> [-o <output.yaml>]
+ *
+ * The output is a `registers:` block in the format of sma_inverter_profile.yaml,
+ * in ascending address order with the description and unit as comments. It can
+ * be pasted into a profile or template; alternatively a profile can reference
+ * the CSV directly with `register_csv:`.
+ */
+
+namespace {
+    void usage(const char* program) {
+        std::cerr << "Usage: " << program << " <register_list.csv> [-o <output.yaml>]" << std::endl;
+    }
+
+    const char* typeName(RegisterType type) {
+        static const char* names[] = {"U16", "S16", "U32", "S32", "U64", "S64"};
+        return names[static_cast<int>(type)];
+    }
+
+    const char* formatName(RegisterFormat format) {
+        static const char* names[] = {"RAW", "ENUM", "FIX0", "FIX1", "FIX2", "FIX3", "FIX4", "DT", "FW", "TEMP",
+                                      "Duration"};
+        return names[static_cast<int>(format)];
+    }
+
+    const char* accessName(RegisterAccess access) {
+        static const char* names[] = {"RO", "RW", "WO"};
+        return names[static_cast<int>(access)];
+    }
+
+    /// Comments must stay on one line, so embedded line breaks become spaces.
+    std::string oneLine(std::string text) {
+        for (char& c : text) {
+            if (c == '\n' || c == '\r') c = ' ';
+        }
+        return text;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string input = argv[1];
+    std::string output;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::ifstream in(input);
+    if (!in) {
+        std::cerr << "Cannot open " << input << std::endl;
+        return 1;
+    }
+    std::vector<SmaRegisterEntry> entries;
+    SmaImportStats stats;
+    std::string error;
+    if (!SmaRegisterCsv::read(in, entries, stats, error, true)) {
+        std::cerr << "Cannot import " << input << ": " << error << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output);
+        if (!file) {
+            std::cerr << "Cannot write " << output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = output.empty() ? std::cout : file;
+
+    out << "# Generated by sma_register_import from " << input << " (" << entries.size() << " registers)\n";
+    out << "registers:\n";
+    for (const auto& entry : entries) {
+        const Register& reg = entry.reg;
+        out << "  - { address: " << reg.address << ", type: " << typeName(reg.type) << ", format: "
+            << formatName(reg.format) << ", access: " << accessName(reg.access) << " }";
+        if (!entry.description.empty() || !entry.unit.empty()) {
+            out << " #";
+            if (!entry.description.empty()) out << " " << oneLine(entry.description);
+            if (!entry.unit.empty()) out << " [" << oneLine(entry.unit) << "]";
+        }
+        out << "\n";
+    }
+
+    std::cerr << stats.rows << " rows: " << stats.imported << " imported, " << stats.unsupported_type
+              << " unsupported types, " << stats.duplicates << " overlapping, " << stats.unknown_format
+              << " with unknown format (imported as RAW)" << std::endl;
+    return out ? 0 : 1;
+}